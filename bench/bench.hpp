@@ -0,0 +1,98 @@
+//
+//  bench.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef bench_hpp
+#define bench_hpp
+
+#include <chrono>
+#include <vector>
+#include <string.h>
+#include "pip.hpp"
+
+/// 基准测试公用函数 每个 bench_*.cpp 单独编译 不需要构建系统
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_xxx.cpp -o bench_xxx
+
+/// 单调时钟 纳秒
+static inline double bench_now_ns() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// 防止结果被编译器优化掉
+static volatile pip_uint64 bench_sink = 0;
+
+/// 构造带正确校验和的 TCP 包
+/// @param src 主机字节序
+/// @param dest 主机字节序
+/// @param options TCP选项 长度必须是4的倍数
+static inline std::vector<pip_uint8> bench_make_tcp(pip_uint32 src, pip_uint32 dest, pip_uint16 sport, pip_uint16 dport, pip_uint32 seq, pip_uint32 ack, pip_uint8 flags, pip_uint16 win, const void * data, pip_uint16 len, const std::vector<pip_uint8> & options = std::vector<pip_uint8>()) {
+    pip_uint16 hdr_len = sizeof(struct tcphdr) + options.size();
+    std::vector<pip_uint8> packet(sizeof(struct ip) + hdr_len + len);
+    
+    struct ip * ip = (struct ip *)packet.data();
+    ip->ip_v = 4;
+    ip->ip_hl = 5;
+    ip->ip_len = htons(packet.size());
+    ip->ip_ttl = 64;
+    ip->ip_p = IPPROTO_TCP;
+    ip->ip_src.s_addr = htonl(src);
+    ip->ip_dst.s_addr = htonl(dest);
+    ip->ip_sum = htons(pip_ip_checksum(ip, sizeof(struct ip)));
+    
+    struct tcphdr * hdr = (struct tcphdr *)(packet.data() + sizeof(struct ip));
+    hdr->th_sport = htons(sport);
+    hdr->th_dport = htons(dport);
+    hdr->th_seq = htonl(seq);
+    hdr->th_ack = htonl(ack);
+    hdr->th_off = hdr_len / 4;
+    hdr->th_flags = flags;
+    hdr->th_win = htons(win);
+    if (options.size() > 0) {
+        memcpy(hdr + 1, options.data(), options.size());
+    }
+    if (len > 0) {
+        memcpy((pip_uint8 *)hdr + hdr_len, data, len);
+    }
+    hdr->th_sum = htons(pip_inet_checksum(hdr, IPPROTO_TCP, src, dest, hdr_len + len));
+    return packet;
+}
+
+/// 构造带正确校验和的 UDP 包
+/// @param src 主机字节序
+/// @param dest 主机字节序
+static inline std::vector<pip_uint8> bench_make_udp(pip_uint32 src, pip_uint32 dest, pip_uint16 sport, pip_uint16 dport, const void * data, pip_uint16 len) {
+    std::vector<pip_uint8> packet(sizeof(struct ip) + sizeof(struct udphdr) + len);
+    
+    struct ip * ip = (struct ip *)packet.data();
+    ip->ip_v = 4;
+    ip->ip_hl = 5;
+    ip->ip_len = htons(packet.size());
+    ip->ip_ttl = 64;
+    ip->ip_p = IPPROTO_UDP;
+    ip->ip_src.s_addr = htonl(src);
+    ip->ip_dst.s_addr = htonl(dest);
+    ip->ip_sum = htons(pip_ip_checksum(ip, sizeof(struct ip)));
+    
+    struct udphdr * hdr = (struct udphdr *)(packet.data() + sizeof(struct ip));
+    hdr->uh_sport = htons(sport);
+    hdr->uh_dport = htons(dport);
+    hdr->uh_ulen = htons(sizeof(struct udphdr) + len);
+    if (len > 0) {
+        memcpy(hdr + 1, data, len);
+    }
+    hdr->uh_sum = htons(pip_inet_checksum(hdr, IPPROTO_UDP, src, dest, sizeof(struct udphdr) + len));
+    return packet;
+}
+
+/// 输出的包合并成连续内存
+static inline std::vector<pip_uint8> bench_flatten(pip_buf * buf) {
+    std::vector<pip_uint8> packet;
+    for (pip_buf * q = buf; q != NULL; q = q->next) {
+        packet.insert(packet.end(), (pip_uint8 *)q->payload, (pip_uint8 *)q->payload + q->payload_len);
+    }
+    return packet;
+}
+
+#endif /* bench_hpp */
@@ -0,0 +1,225 @@
+//
+//  bench_alloc.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <stdlib.h>
+
+/// 每个数据包的堆分配次数 对方发送数据 协议栈收到后原样写回 对方确认
+/// 池分配次数就是没有对象池时需要的 malloc 次数
+/// 分别测量 写回复制到发送缓冲 写回使用借出缓冲 每两个数据段交换顺序到达 经过乱序重组
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_alloc.cpp -o bench_alloc
+/// ./bench_alloc [往返次数]
+
+#define BENCH_PEER_IP       0x0a000001
+#define BENCH_STACK_IP      0x0a000002
+#define BENCH_PEER_PORT     10000
+#define BENCH_STACK_PORT    80
+#define BENCH_PAYLOAD_LEN   1400
+
+static pip_uint64 malloc_count = 0;
+
+#ifdef __GLIBC__
+/// glibc 下替换 malloc 统计所有堆分配 包括 operator new
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void * __libc_calloc(size_t count, size_t size);
+extern "C" void * __libc_realloc(void * ptr, size_t size);
+
+extern "C" void * malloc(size_t size) {
+    malloc_count++;
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size) {
+    malloc_count++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size) {
+    malloc_count++;
+    return __libc_realloc(ptr, size);
+}
+#else
+/// 其他平台只统计 operator new
+void * operator new(size_t size) {
+    malloc_count++;
+    void * ptr = malloc(size);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    free(ptr);
+}
+#endif
+
+static pip_tcp * stack_tcp = NULL;
+static pip_uint32 peer_seq = 1000;
+static pip_uint32 peer_rcv_nxt = 0;
+
+/// 协议栈收发的包数
+static pip_uint64 packet_count = 0;
+
+/// 写回方式
+enum bench_echo_mode {
+    bench_echo_copy,
+    bench_echo_lent,
+};
+static bench_echo_mode echo_mode = bench_echo_copy;
+
+/// 借出缓冲的数据 确认前保持有效
+static pip_uint8 lent_payload[BENCH_PAYLOAD_LEN];
+
+/// 预先构造的输入包 避免把构造过程计入分配次数
+static std::vector<pip_uint8> data_packets[2];
+static std::vector<pip_uint8> ack_packet;
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    packet_count++;
+    
+    /// 只读取头部 不拷贝整个包
+    const struct ip * ip = (const struct ip *)buf->payload;
+    const struct tcphdr * hdr = (const struct tcphdr *)((const pip_uint8 *)buf->payload + ip->ip_hl * 4);
+    pip_uint32 len = buf->total_len - ip->ip_hl * 4 - hdr->th_off * 4;
+    if (hdr->th_flags & TH_SYN) {
+        peer_rcv_nxt = ntohl(hdr->th_seq) + 1;
+    } else if (len > 0) {
+        peer_rcv_nxt = ntohl(hdr->th_seq) + len;
+    }
+}
+
+static void received_callback(pip_tcp * tcp, const void * buffer, pip_uint32 buffer_len) {
+    /// 原样写回 写入发送缓冲后立即确认接收
+    if (echo_mode == bench_echo_lent) {
+        struct iovec iov;
+        iov.iov_base = lent_payload;
+        iov.iov_len = buffer_len;
+        tcp->writev_lent(&iov, 1, NULL, NULL);
+    } else {
+        tcp->write(buffer, buffer_len);
+    }
+    tcp->received(buffer_len);
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    stack_tcp = tcp;
+    tcp->received_callback = received_callback;
+    tcp->connected(take_data);
+}
+
+/// 对方发送一个数据段 data_packets 两个包轮流使用
+static void peer_send_data(pip_netif * netif, pip_uint32 i, pip_uint32 seq) {
+    std::vector<pip_uint8> & packet = data_packets[i & 1];
+    struct tcphdr * hdr = (struct tcphdr *)(packet.data() + sizeof(struct ip));
+    hdr->th_seq = htonl(seq);
+    hdr->th_ack = htonl(peer_rcv_nxt);
+    hdr->th_sum = 0;
+    hdr->th_sum = htons(pip_inet_checksum(hdr, IPPROTO_TCP, BENCH_PEER_IP, BENCH_STACK_IP, packet.size() - sizeof(struct ip)));
+    packet_count++;
+    netif->input(packet.data());
+}
+
+/// 对方确认收到的所有数据
+static void peer_send_ack(pip_netif * netif) {
+    struct tcphdr * hdr = (struct tcphdr *)(ack_packet.data() + sizeof(struct ip));
+    hdr->th_seq = htonl(peer_seq);
+    hdr->th_ack = htonl(peer_rcv_nxt);
+    hdr->th_sum = 0;
+    hdr->th_sum = htons(pip_inet_checksum(hdr, IPPROTO_TCP, BENCH_PEER_IP, BENCH_STACK_IP, ack_packet.size() - sizeof(struct ip)));
+    packet_count++;
+    netif->input(ack_packet.data());
+}
+
+/// 一次往返 对方发送数据 协议栈写回 对方确认
+static void round_trip(pip_netif * netif, pip_uint32 i) {
+    peer_send_data(netif, i, peer_seq);
+    peer_seq += BENCH_PAYLOAD_LEN;
+    peer_send_ack(netif);
+    netif->timer_tick();
+}
+
+/// 两个数据段交换顺序到达 后一个进入乱序队列 前一个补上空缺
+static void reorder_round_trip(pip_netif * netif, pip_uint32 i) {
+    peer_send_data(netif, i + 1, peer_seq + BENCH_PAYLOAD_LEN);
+    peer_send_data(netif, i, peer_seq);
+    peer_seq += 2 * BENCH_PAYLOAD_LEN;
+    peer_send_ack(netif);
+    netif->timer_tick();
+}
+
+static pip_uint64 pool_allocs() {
+    return pip_buf::get_pool()->get_stats().allocs +
+        pip_tcp_packet::get_pool()->get_stats().allocs +
+        pip_tcp::get_lent_pool()->get_stats().allocs +
+        pip_tcp_reass::get_pool()->get_stats().allocs;
+}
+
+static void measure(pip_netif * netif, const char * name, void (*round)(pip_netif *, pip_uint32), pip_uint32 rounds, pip_uint32 start) {
+    pip_uint64 mallocs = malloc_count;
+    pip_uint64 allocs = pool_allocs();
+    pip_uint64 packets = packet_count;
+    for (pip_uint32 i = 0; i < rounds; i++) {
+        round(netif, (start + i) * 2);
+    }
+    mallocs = malloc_count - mallocs;
+    allocs = pool_allocs() - allocs;
+    packets = packet_count - packets;
+    printf("%-8s  %8u  %16.3f  %14.3f\n", name, rounds, mallocs / (double)packets, allocs / (double)packets);
+}
+
+static void print_pool(const char * name, pip_pool * pool) {
+    pip_pool_stats stats = pool->get_stats();
+    printf("%-16s  allocs %10llu  frees %10llu  slabs %4llu  in_use %6u  capacity %6u\n", name, (unsigned long long)stats.allocs, (unsigned long long)stats.frees, (unsigned long long)stats.slab_allocs, stats.in_use, stats.capacity);
+}
+
+int main(int argc, const char * argv[]) {
+    pip_uint32 rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    
+    static pip_uint8 payload[BENCH_PAYLOAD_LEN];
+    for (int i = 0; i < 2; i++) {
+        data_packets[i] = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, BENCH_PEER_PORT, BENCH_STACK_PORT, 0, 0, TH_ACK | TH_PUSH, 0xffff, payload, sizeof(payload));
+    }
+    ack_packet = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, BENCH_PEER_PORT, BENCH_STACK_PORT, 0, 0, TH_ACK, 0xffff, NULL, 0);
+    
+    /// 握手
+    std::vector<pip_uint8> syn = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, BENCH_PEER_PORT, BENCH_STACK_PORT, peer_seq, 0, TH_SYN, 0xffff, NULL, 0);
+    netif->input(syn.data());
+    peer_seq += 1;
+    std::vector<pip_uint8> ack = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, BENCH_PEER_PORT, BENCH_STACK_PORT, peer_seq, peer_rcv_nxt, TH_ACK, 0xffff, NULL, 0);
+    netif->input(ack.data());
+    if (stack_tcp == NULL || stack_tcp->status != pip_tcp_status_established) {
+        printf("handshake failed\n");
+        return 1;
+    }
+    
+    printf("phase     rounds    malloc/packet  pool/packet\n");
+    /// 冷启动 对象池按需申请 slab
+    measure(netif, "cold", round_trip, 100, 0);
+    /// 稳定后 对象都从空闲链表复用
+    measure(netif, "warm", round_trip, rounds, 100);
+    
+    /// 借出缓冲和乱序重组 先预热再测量
+    echo_mode = bench_echo_lent;
+    measure(netif, "lent", round_trip, 100, 0);
+    measure(netif, "lent", round_trip, rounds, 100);
+    echo_mode = bench_echo_copy;
+    measure(netif, "reorder", reorder_round_trip, 100, 0);
+    measure(netif, "reorder", reorder_round_trip, rounds, 100);
+    printf("\n");
+    print_pool("pip_buf", pip_buf::get_pool());
+    print_pool("pip_tcp_packet", pip_tcp_packet::get_pool());
+    print_pool("pip_tcp", pip_tcp::get_pool());
+    print_pool("pip_tcp_lent", pip_tcp::get_lent_pool());
+    print_pool("pip_tcp_reass", pip_tcp_reass::get_pool());
+    
+    stack_tcp->reset();
+    return 0;
+}
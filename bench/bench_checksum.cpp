@@ -0,0 +1,65 @@
+//
+//  bench_checksum.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <stdlib.h>
+
+/// 每个 checksum 实现在常见包长下的吞吐 GB/s 当前 CPU 不支持的实现跳过
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_checksum.cpp -o bench_checksum
+/// ./bench_checksum [每组字节数MiB]
+
+/// 缓冲起始偏移 覆盖非对齐的情况
+#define BENCH_ALIGNS    8
+
+int main(int argc, const char * argv[]) {
+    pip_uint64 total = (pip_uint64)(argc > 1 ? atoi(argv[1]) : 512) * 1024 * 1024;
+    
+    /// 常见包长 纯确认 小包 中等包 MSS 巨帧 最大IP包
+    const int sizes[] = {40, 64, 576, 1460, 9000, 65535};
+    const int size_count = sizeof(sizes) / sizeof(sizes[0]);
+    
+    std::vector<pip_uint8> data(65535 + BENCH_ALIGNS);
+    pip_uint32 state = 12345;
+    for (size_t i = 0; i < data.size(); i++) {
+        state = state * 1103515245 + 12345;
+        data[i] = (pip_uint8)(state >> 16);
+    }
+    
+    pip_checksum_kernel original = pip_checksum_get_kernel();
+    
+    printf("%-10s", "kernel");
+    for (int i = 0; i < size_count; i++) {
+        printf("  %7d", sizes[i]);
+    }
+    printf("  (GB/s)\n");
+    
+    for (int k = 0; k < pip_checksum_kernel_count; k++) {
+        pip_checksum_kernel kernel = (pip_checksum_kernel)k;
+        if (!pip_checksum_set_kernel(kernel)) {
+            printf("%-10s  not supported\n", pip_checksum_kernel_name(kernel));
+            continue;
+        }
+        
+        printf("%-10s", pip_checksum_kernel_name(kernel));
+        for (int i = 0; i < size_count; i++) {
+            pip_uint64 count = total / sizes[i];
+            pip_uint32 sum = 0;
+            
+            double start = bench_now_ns();
+            for (pip_uint64 n = 0; n < count; n++) {
+                sum += pip_standard_checksum(data.data() + (n % BENCH_ALIGNS), sizes[i], 0);
+            }
+            double elapsed = bench_now_ns() - start;
+            bench_sink += sum;
+            
+            printf("  %7.2f", count * sizes[i] / elapsed);
+        }
+        printf("\n");
+    }
+    
+    pip_checksum_set_kernel(original);
+    return 0;
+}
@@ -0,0 +1,122 @@
+//
+//  bench_input_batch.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <stdlib.h>
+
+/// 单连接接收 对比 input 和不同批大小的 input_batch 统计每秒处理的包数和回复的纯确认数
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_input_batch.cpp -o bench_input_batch
+/// ./bench_input_batch [轮数]
+
+#define BENCH_PEER_IP       0x0a000001
+#define BENCH_STACK_IP      0x0a000002
+#define BENCH_STACK_PORT    80
+#define BENCH_PAYLOAD_LEN   1000
+
+/// 每轮一个新连接 预先构造的包数
+#define BENCH_ROUND_PACKETS 8192
+
+static pip_tcp * stack_tcp = NULL;
+static pip_uint32 stack_seq = 0;
+static pip_uint64 pure_acks = 0;
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    /// 只读取头部 不拷贝整个包
+    const struct ip * ip = (const struct ip *)buf->payload;
+    const struct tcphdr * hdr = (const struct tcphdr *)((const pip_uint8 *)buf->payload + ip->ip_hl * 4);
+    if (hdr->th_flags & TH_SYN) {
+        stack_seq = ntohl(hdr->th_seq) + 1;
+        return;
+    }
+    
+    /// 结束时的 RST 不计入
+    if (!(hdr->th_flags & TH_RST) && buf->total_len == ip->ip_hl * 4 + hdr->th_off * 4) {
+        pure_acks++;
+    }
+}
+
+static void received_callback(pip_tcp * tcp, const void *, pip_uint32 buffer_len) {
+    tcp->received(buffer_len);
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    stack_tcp = tcp;
+    tcp->received_callback = received_callback;
+    tcp->connected(take_data);
+}
+
+/// 建立一个新连接 返回之后数据包使用的序号
+static pip_uint32 open_connection(pip_netif * netif, pip_uint16 port) {
+    pip_uint32 seq = 1000;
+    std::vector<pip_uint8> syn = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, 0, TH_SYN, 0xffff, NULL, 0);
+    netif->input(syn.data());
+    seq += 1;
+    
+    std::vector<pip_uint8> ack = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, stack_seq, TH_ACK, 0xffff, NULL, 0);
+    netif->input(ack.data());
+    return seq;
+}
+
+/// batch 为0时逐个调用 input
+static void run(int batch, int rounds) {
+    pip_netif * netif = pip_netif::shared();
+    static pip_uint16 port = 10000;
+    static pip_uint8 payload[BENCH_PAYLOAD_LEN];
+    
+    std::vector<std::vector<pip_uint8> > packets(BENCH_ROUND_PACKETS);
+    std::vector<const void *> pointers(BENCH_ROUND_PACKETS);
+    std::vector<pip_uint32> lengths(BENCH_ROUND_PACKETS);
+    
+    double elapsed = 0;
+    pip_uint64 total = 0;
+    pure_acks = 0;
+    
+    for (int round = 0; round < rounds; round++) {
+        port++;
+        pip_uint32 seq = open_connection(netif, port);
+        for (int i = 0; i < BENCH_ROUND_PACKETS; i++) {
+            packets[i] = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, stack_seq, TH_ACK, 0xffff, payload, sizeof(payload));
+            pointers[i] = packets[i].data();
+            lengths[i] = (pip_uint32)packets[i].size();
+            seq += sizeof(payload);
+        }
+        
+        double start = bench_now_ns();
+        if (batch == 0) {
+            for (int i = 0; i < BENCH_ROUND_PACKETS; i++) {
+                netif->input(pointers[i]);
+            }
+        } else {
+            for (int i = 0; i < BENCH_ROUND_PACKETS; i += batch) {
+                netif->input_batch(pointers.data() + i, lengths.data() + i, PIP_MIN(batch, BENCH_ROUND_PACKETS - i));
+            }
+        }
+        elapsed += bench_now_ns() - start;
+        total += BENCH_ROUND_PACKETS;
+        
+        if (stack_tcp) {
+            stack_tcp->reset();
+            stack_tcp = NULL;
+        }
+    }
+    
+    printf("%5d  %10.2f  %17.3f\n", batch == 0 ? 1 : batch, total / (elapsed / 1e9) / 1e6, pure_acks / (double)total);
+}
+
+int main(int argc, const char * argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 100;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    
+    printf("batch  rate(Mpps)  pure acks/packet\n");
+    const int batches[] = {0, 8, 32, 64};
+    for (int batch : batches) {
+        run(batch, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+//
+//  bench_tcp_goodput.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <deque>
+#include <map>
+
+/// 单连接下行吞吐 经过模拟的有时延和丢包的链路 对比不同 RTT 和发送缓冲
+/// 没有丢包时吞吐约等于 min(snd_buf, 对方窗口) / RTT 有丢包时受拥塞窗口限制
+/// 同一 RTT 和丢包率下 发送缓冲增大后吞吐下降超过 BENCH_GOODPUT_TOLERANCE 时输出 FAIL 并返回非0
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_tcp_goodput.cpp -o bench_tcp_goodput
+/// ./bench_tcp_goodput [每组毫秒数]
+
+#define BENCH_PEER_IP       0x0a000001
+#define BENCH_STACK_IP      0x0a000002
+#define BENCH_STACK_PORT    80
+
+/// 对方窗口扩大因子 通告 0xffff << 7 约 8MB 不限制发送
+#define BENCH_PEER_WSCALE   7
+
+/// 允许的吞吐波动 随机丢包下相邻两组的结果不完全一致
+#define BENCH_GOODPUT_TOLERANCE 0.9
+
+struct bench_link_packet {
+    pip_uint64 due;
+    std::vector<pip_uint8> data;
+};
+
+/// 当前一组配置
+struct bench_config {
+    pip_uint32 rtt;
+    double loss;
+    pip_uint32 snd_buf;
+};
+
+static bench_config config;
+static pip_uint16 peer_port = 10000;
+static pip_tcp * stack_tcp = NULL;
+
+/// 协议栈到对方 对方到协议栈 两个方向的链路
+static std::deque<bench_link_packet> to_peer;
+static std::deque<bench_link_packet> to_stack;
+
+/// 对方接收状态
+static pip_uint32 peer_seq = 0;
+static pip_uint32 peer_rcv_nxt = 0;
+static std::map<pip_uint32, pip_uint32> peer_ooo;
+static pip_uint64 peer_delivered = 0;
+
+static pip_uint64 rand_state = 88172645463325252ULL;
+static double bench_random() {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return (rand_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    std::vector<pip_uint8> packet = bench_flatten(buf);
+    const struct ip * ip = (const struct ip *)packet.data();
+    const struct tcphdr * hdr = (const struct tcphdr *)(packet.data() + ip->ip_hl * 4);
+    if (ntohs(hdr->th_dport) != peer_port) {
+        /// 之前配置的连接
+        return;
+    }
+    
+    pip_uint32 len = ntohs(ip->ip_len) - ip->ip_hl * 4 - hdr->th_off * 4;
+    if (len > 0 && bench_random() < config.loss) {
+        return;
+    }
+    
+    bench_link_packet link = {get_current_time() + config.rtt / 2, packet};
+    to_peer.push_back(link);
+}
+
+static void written_callback(pip_tcp *, pip_uint32) {
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    stack_tcp = tcp;
+    tcp->snd_buf = config.snd_buf;
+    tcp->written_callback = written_callback;
+    tcp->connected(take_data);
+}
+
+static void peer_send(pip_uint8 flags, const std::vector<pip_uint8> & options = std::vector<pip_uint8>()) {
+    std::vector<pip_uint8> packet = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, peer_port, BENCH_STACK_PORT, peer_seq, peer_rcv_nxt, flags, 0xffff, NULL, 0, options);
+    bench_link_packet link = {get_current_time() + config.rtt / 2, packet};
+    to_stack.push_back(link);
+}
+
+/// 对方收到包 按序的数据交给上层 乱序的先记录 每个包回复一个累计确认
+static void peer_input(const std::vector<pip_uint8> & packet) {
+    const struct ip * ip = (const struct ip *)packet.data();
+    const struct tcphdr * hdr = (const struct tcphdr *)(packet.data() + ip->ip_hl * 4);
+    pip_uint32 seq = ntohl(hdr->th_seq);
+    pip_uint32 len = ntohs(ip->ip_len) - ip->ip_hl * 4 - hdr->th_off * 4;
+    
+    if (hdr->th_flags & TH_SYN) {
+        peer_rcv_nxt = seq + 1;
+        peer_send(TH_ACK);
+        return;
+    }
+    
+    if (len <= 0) {
+        return;
+    }
+    
+    if (seq == peer_rcv_nxt) {
+        peer_rcv_nxt += len;
+        peer_delivered += len;
+        
+        std::map<pip_uint32, pip_uint32>::iterator it = peer_ooo.begin();
+        while (it != peer_ooo.end() && (pip_int32)(it->first - peer_rcv_nxt) <= 0) {
+            pip_uint32 end = it->first + it->second;
+            if ((pip_int32)(end - peer_rcv_nxt) > 0) {
+                peer_delivered += end - peer_rcv_nxt;
+                peer_rcv_nxt = end;
+            }
+            it = peer_ooo.erase(it);
+        }
+    
+    } else if ((pip_int32)(seq - peer_rcv_nxt) > 0) {
+        peer_ooo[seq] = len;
+    }
+    
+    peer_send(TH_ACK);
+}
+
+static double run(pip_uint64 duration) {
+    peer_port += 1;
+    peer_seq = 1000;
+    peer_rcv_nxt = 0;
+    peer_ooo.clear();
+    peer_delivered = 0;
+    to_peer.clear();
+    to_stack.clear();
+    stack_tcp = NULL;
+    
+    /// MSS 1460 窗口扩大因子
+    std::vector<pip_uint8> options = {2, 4, 0x05, 0xb4, 1, 3, 3, BENCH_PEER_WSCALE};
+    peer_send(TH_SYN, options);
+    peer_seq += 1;
+    
+    static pip_uint8 data[64 * 1024];
+    pip_netif * netif = pip_netif::shared();
+    pip_uint64 start = get_current_time();
+    pip_uint64 end = start + duration;
+    
+    while (true) {
+        pip_uint64 now = get_current_time();
+        if (now >= end) {
+            break;
+        }
+        
+        while (!to_peer.empty() && to_peer.front().due <= now) {
+            std::vector<pip_uint8> packet;
+            packet.swap(to_peer.front().data);
+            to_peer.pop_front();
+            peer_input(packet);
+        }
+        
+        while (!to_stack.empty() && to_stack.front().due <= now) {
+            std::vector<pip_uint8> packet;
+            packet.swap(to_stack.front().data);
+            to_stack.pop_front();
+            netif->input(packet.data());
+        }
+        
+        netif->timer_tick();
+        
+        if (stack_tcp && stack_tcp->status == pip_tcp_status_established) {
+            while (stack_tcp->can_write()) {
+                if (stack_tcp->write(data, sizeof(data)) <= 0) {
+                    break;
+                }
+            }
+        }
+    }
+    
+    if (stack_tcp) {
+        stack_tcp->reset();
+    }
+    return peer_delivered * 8.0 / (duration / 1000.0) / 1e6;
+}
+
+int main(int argc, const char * argv[]) {
+    pip_uint64 duration = argc > 1 ? atoi(argv[1]) : 2000;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    
+    const pip_uint32 rtts[] = {10, 50};
+    const double losses[] = {0, 0.01};
+    const pip_uint32 snd_bufs[] = {64 * 1024, 256 * 1024, 1024 * 1024};
+    
+    int failed = 0;
+    printf("rtt(ms)  loss  snd_buf(KiB)  goodput(Mbit/s)  snd_buf/rtt(Mbit/s)\n");
+    for (pip_uint32 rtt : rtts) {
+        for (double loss : losses) {
+            double previous = 0;
+            for (pip_uint32 snd_buf : snd_bufs) {
+                config.rtt = rtt;
+                config.loss = loss;
+                config.snd_buf = snd_buf;
+                
+                double goodput = run(duration);
+                printf("%7u  %4.0f%%  %12u  %15.1f  %19.1f\n", rtt, loss * 100, snd_buf / 1024, goodput, snd_buf * 8.0 / (rtt / 1000.0) / 1e6);
+                
+                /// 更大的发送缓冲不应该让吞吐变差
+                if (goodput < previous * BENCH_GOODPUT_TOLERANCE) {
+                    printf("FAIL goodput dropped from %.1f to %.1f Mbit/s as snd_buf grew\n", previous, goodput);
+                    failed++;
+                }
+                previous = PIP_MAX(previous, goodput);
+            }
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
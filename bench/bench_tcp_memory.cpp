@@ -0,0 +1,98 @@
+//
+//  bench_tcp_memory.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include "pip_mem.hpp"
+#include <stdlib.h>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+/// 建立大量空闲连接 统计每个连接占用的内存
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_tcp_memory.cpp -o bench_tcp_memory
+/// ./bench_tcp_memory [连接数]
+
+#define BENCH_PEER_IP       0x0a000000
+#define BENCH_STACK_IP      0x0b000001
+#define BENCH_STACK_PORT    80
+
+static pip_uint32 connected = 0;
+static pip_uint32 last_seq = 0;
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    std::vector<pip_uint8> packet = bench_flatten(buf);
+    const struct ip * ip = (const struct ip *)packet.data();
+    const struct tcphdr * hdr = (const struct tcphdr *)(packet.data() + ip->ip_hl * 4);
+    last_seq = ntohl(hdr->th_seq);
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    connected++;
+    tcp->connected(take_data);
+}
+
+/// 进程常驻内存 字节 不支持的平台返回0
+static pip_uint64 resident_bytes() {
+#if defined(__linux__)
+    FILE * file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return (pip_uint64)resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+int main(int argc, const char * argv[]) {
+    pip_uint32 count = argc > 1 ? atoi(argv[1]) : PIP_TCP_MAX_CONNS;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    
+    pip_uint64 rss_before = resident_bytes();
+    pip_mem_stats mem_before = pip_mem::get_stats();
+    
+    /// 每个连接使用不同的来源地址和端口 完成三次握手后保持空闲
+    for (pip_uint32 i = 0; i < count; i++) {
+        pip_uint32 src = BENCH_PEER_IP + 1 + i / 50000;
+        pip_uint16 sport = 10000 + i % 50000;
+        
+        std::vector<pip_uint8> syn = bench_make_tcp(src, BENCH_STACK_IP, sport, BENCH_STACK_PORT, 1000, 0, TH_SYN, 0xffff, NULL, 0);
+        netif->input(syn.data());
+        
+        std::vector<pip_uint8> ack = bench_make_tcp(src, BENCH_STACK_IP, sport, BENCH_STACK_PORT, 1001, last_seq + 1, TH_ACK, 0xffff, NULL, 0);
+        netif->input(ack.data());
+    }
+    
+    pip_uint64 rss_after = resident_bytes();
+    pip_mem_stats mem_after = pip_mem::get_stats();
+    pip_pool_stats pool = pip_tcp::get_pool()->get_stats();
+    pip_uint32 slot = (sizeof(pip_tcp) + PIP_CACHE_LINE - 1) / PIP_CACHE_LINE * PIP_CACHE_LINE;
+    
+    printf("connections            %u of %u\n", connected, count);
+    printf("sizeof(pip_tcp)        %zu bytes\n", sizeof(pip_tcp));
+    printf("pool slot              %u bytes\n", slot);
+    printf("pool capacity          %u slots, %llu slabs, %.1f MiB\n", pool.capacity, (unsigned long long)pool.slab_allocs, pool.capacity * (double)slot / 1048576);
+    if (connected > 0) {
+        printf("pip_mem charged        %.1f bytes/conn (conn %.1f, snd %.1f, reass %.1f)\n",
+               (mem_after.used - mem_before.used) / (double)connected,
+               (mem_after.type_used[pip_mem_type_tcp_conn] - mem_before.type_used[pip_mem_type_tcp_conn]) / (double)connected,
+               (mem_after.type_used[pip_mem_type_tcp_snd] - mem_before.type_used[pip_mem_type_tcp_snd]) / (double)connected,
+               (mem_after.type_used[pip_mem_type_tcp_reass] - mem_before.type_used[pip_mem_type_tcp_reass]) / (double)connected);
+        if (rss_after > 0) {
+            printf("resident growth        %.1f bytes/conn, %.1f MiB total\n", (rss_after - rss_before) / (double)connected, (rss_after - rss_before) / 1048576.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+//
+//  bench_udp_echo.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <stdlib.h>
+
+/// UDP 回显 每个输入包在接收回调中原样发回 对比字符串地址接口 二进制地址接口和零拷贝发送
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_udp_echo.cpp -o bench_udp_echo
+/// ./bench_udp_echo [每组包数]
+
+#define BENCH_PEER_IP       0x0a000001
+#define BENCH_STACK_IP      0x0a000002
+#define BENCH_PEER_PORT     10000
+#define BENCH_STACK_PORT    53
+
+static pip_uint64 output_packets = 0;
+
+/// 零拷贝发送使用的缓冲 预留了 UDP 和 IP 头部
+static pip_buf * echo_buf = NULL;
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    output_packets++;
+    bench_sink += buf->total_len;
+}
+
+/// 字符串地址 接收时格式化地址 发送时再解析
+static void received_udp_data_callback(pip_netif *, void * buffer, pip_uint16 buffer_len, const char * src_ip, pip_uint16 src_port, const char * dest_ip, pip_uint16 dest_port, pip_uint8) {
+    pip_udp::output(buffer, buffer_len, dest_ip, dest_port, src_ip, src_port);
+}
+
+/// 二进制地址 数据复制一次
+static void received_udp_packet_callback(pip_netif *, void * buffer, pip_uint16 buffer_len, const pip_addr * src, const pip_addr * dest) {
+    pip_udp::output(buffer, buffer_len, dest, src);
+}
+
+/// 二进制地址 数据写入预留了头部的缓冲后零拷贝发送
+static void received_udp_packet_buf_callback(pip_netif *, void * buffer, pip_uint16 buffer_len, const pip_addr * src, const pip_addr * dest) {
+    memcpy(echo_buf->payload, buffer, buffer_len);
+    echo_buf->payload_len = buffer_len;
+    echo_buf->total_len = buffer_len;
+    pip_udp::output_buf(echo_buf, dest, src);
+}
+
+static double run(const std::vector<pip_uint8> & packet, pip_uint32 count) {
+    pip_netif * netif = pip_netif::shared();
+    output_packets = 0;
+    
+    double start = bench_now_ns();
+    for (pip_uint32 i = 0; i < count; i++) {
+        netif->input(packet.data());
+    }
+    double elapsed = bench_now_ns() - start;
+    
+    if (output_packets != count) {
+        printf("lost %llu packets\n", (unsigned long long)(count - output_packets));
+    }
+    return count / (elapsed / 1e9);
+}
+
+int main(int argc, const char * argv[]) {
+    pip_uint32 count = argc > 1 ? atoi(argv[1]) : 1000000;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    echo_buf = new pip_buf(PIP_UDP_HEADROOM, 0xffff - PIP_UDP_HEADROOM);
+    
+    const pip_uint16 sizes[] = {64, 512, 1400};
+    static pip_uint8 payload[1400];
+    
+    printf("payload  string(Mpps)  pip_addr(Mpps)  output_buf(Mpps)\n");
+    for (pip_uint16 size : sizes) {
+        std::vector<pip_uint8> packet = bench_make_udp(BENCH_PEER_IP, BENCH_STACK_IP, BENCH_PEER_PORT, BENCH_STACK_PORT, payload, size);
+        
+        netif->received_udp_packet_callback = NULL;
+        netif->received_udp_data_callback = received_udp_data_callback;
+        double str_pps = run(packet, count);
+        
+        netif->received_udp_packet_callback = received_udp_packet_callback;
+        double addr_pps = run(packet, count);
+        
+        netif->received_udp_packet_callback = received_udp_packet_buf_callback;
+        double buf_pps = run(packet, count);
+        
+        printf("%7u  %12.2f  %14.2f  %16.2f\n", size, str_pps / 1e6, addr_pps / 1e6, buf_pps / 1e6);
+    }
+    
+    delete echo_buf;
+    return 0;
+}
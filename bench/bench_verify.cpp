@@ -0,0 +1,130 @@
+//
+//  bench_verify.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "bench.hpp"
+#include <stdlib.h>
+
+/// 输入校验的开销 开启和关闭 set_verify_checksum 时每个输入包的处理时间
+/// TCP 为单连接按序接收的数据段 UDP 为只计数不回复的数据包
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp bench/bench_verify.cpp -o bench_verify
+/// ./bench_verify [每组包数]
+
+#define BENCH_PEER_IP       0x0a000001
+#define BENCH_STACK_IP      0x0a000002
+#define BENCH_STACK_PORT    80
+
+/// 每个连接预先构造的包数
+#define BENCH_ROUND_PACKETS 4096
+
+static pip_tcp * stack_tcp = NULL;
+static pip_uint32 stack_seq = 0;
+static pip_uint64 received_udp = 0;
+
+static void output_callback(pip_netif *, pip_buf * buf) {
+    const struct ip * ip = (const struct ip *)buf->payload;
+    const struct tcphdr * hdr = (const struct tcphdr *)((const pip_uint8 *)buf->payload + ip->ip_hl * 4);
+    if (ip->ip_p == IPPROTO_TCP && (hdr->th_flags & TH_SYN)) {
+        stack_seq = ntohl(hdr->th_seq) + 1;
+    }
+}
+
+static void received_callback(pip_tcp * tcp, const void *, pip_uint32 buffer_len) {
+    tcp->received(buffer_len);
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    stack_tcp = tcp;
+    tcp->received_callback = received_callback;
+    tcp->connected(take_data);
+}
+
+static void received_udp_packet_callback(pip_netif *, void *, pip_uint16, const pip_addr *, const pip_addr *) {
+    received_udp++;
+}
+
+/// TCP 每个包的纳秒数
+static double run_tcp(pip_uint16 len, pip_uint32 count) {
+    pip_netif * netif = pip_netif::shared();
+    static pip_uint16 port = 10000;
+    static pip_uint8 payload[1460];
+    
+    std::vector<std::vector<pip_uint8> > packets(BENCH_ROUND_PACKETS);
+    double elapsed = 0;
+    pip_uint32 done = 0;
+    
+    while (done < count) {
+        port++;
+        pip_uint32 seq = 1000;
+        std::vector<pip_uint8> syn = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, 0, TH_SYN, 0xffff, NULL, 0);
+        netif->input(syn.data());
+        seq += 1;
+        std::vector<pip_uint8> ack = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, stack_seq, TH_ACK, 0xffff, NULL, 0);
+        netif->input(ack.data());
+        
+        for (int i = 0; i < BENCH_ROUND_PACKETS; i++) {
+            packets[i] = bench_make_tcp(BENCH_PEER_IP, BENCH_STACK_IP, port, BENCH_STACK_PORT, seq, stack_seq, TH_ACK, 0xffff, payload, len);
+            seq += len;
+        }
+        
+        double start = bench_now_ns();
+        for (int i = 0; i < BENCH_ROUND_PACKETS; i++) {
+            netif->input(packets[i].data());
+        }
+        elapsed += bench_now_ns() - start;
+        done += BENCH_ROUND_PACKETS;
+        
+        if (stack_tcp) {
+            stack_tcp->reset();
+            stack_tcp = NULL;
+        }
+    }
+    return elapsed / done;
+}
+
+/// UDP 每个包的纳秒数
+static double run_udp(pip_uint16 len, pip_uint32 count) {
+    pip_netif * netif = pip_netif::shared();
+    static pip_uint8 payload[1460];
+    std::vector<pip_uint8> packet = bench_make_udp(BENCH_PEER_IP, BENCH_STACK_IP, 10000, 53, payload, len);
+    
+    received_udp = 0;
+    double start = bench_now_ns();
+    for (pip_uint32 i = 0; i < count; i++) {
+        netif->input(packet.data());
+    }
+    double elapsed = bench_now_ns() - start;
+    
+    if (received_udp != count) {
+        printf("lost %llu packets\n", (unsigned long long)(count - received_udp));
+    }
+    return elapsed / count;
+}
+
+int main(int argc, const char * argv[]) {
+    pip_uint32 count = argc > 1 ? atoi(argv[1]) : 1000000;
+    
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    netif->received_udp_packet_callback = received_udp_packet_callback;
+    
+    const pip_uint16 sizes[] = {64, 512, 1460};
+    
+    printf("proto  payload  off(ns/pkt)  on(ns/pkt)  cost(ns/pkt)\n");
+    for (int proto = 0; proto < 2; proto++) {
+        for (pip_uint16 size : sizes) {
+            double ns[2];
+            for (int verify = 0; verify < 2; verify++) {
+                netif->set_verify_checksum(verify);
+                ns[verify] = proto == 0 ? run_tcp(size, count) : run_udp(size, count);
+            }
+            printf("%-5s  %7u  %11.1f  %10.1f  %12.1f\n", proto == 0 ? "tcp" : "udp", size, ns[0], ns[1], ns[1] - ns[0]);
+        }
+    }
+    
+    netif->set_verify_checksum(PIP_NETIF_VERIFY_CHECKSUM);
+    return 0;
+}
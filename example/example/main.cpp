@@ -6,6 +6,7 @@
 //
 
 #include <iostream>
+#include <string.h>
 #include "pip.hpp"
 
 /// 输出IP包
@@ -17,7 +18,7 @@ void _pip_netif_output_ip_data_callback (pip_netif * netif, pip_buf * buf) {
 /// 接受到TCP连接
 void _pip_netif_new_tcp_connect_callback (pip_netif * netif, pip_tcp * tcp, const void * take_data, pip_uint16 take_data_len) {
     std::cout << "_pip_netif_new_tcp_connect_callback" << std::endl;
-    std::cout << "tcp: " << tcp->ip_header->src_str << ":" << tcp->src_port << " <--> " << tcp->ip_header->dest_str << ":" << tcp->dest_port << std::endl;
+    std::cout << "tcp: " << pip_ip_to_str(tcp->src_ip).str << ":" << tcp->src_port << " <--> " << pip_ip_to_str(tcp->dest_ip).str << ":" << tcp->dest_port << std::endl;
     std::cout << std::endl;
     /// 回应连接
     tcp->connected(take_data);
@@ -0,0 +1,169 @@
+//
+//  pip_arena.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_arena.hpp"
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+/// 大页大小 内存区按该对齐
+#define PIP_ARENA_HUGE_PAGE     (2 * 1024 * 1024)
+
+/// 尺寸种类 最大块 PIP_ARENA_SLOT << (PIP_ARENA_CLASSES - 1)
+#define PIP_ARENA_CLASSES       24
+
+struct pip_arena_node {
+    pip_arena_node * next;
+};
+
+static pip_uint8 * arena_base = NULL;
+
+/// 每个 slot 一个字节 记录从该 slot 开始的块的尺寸种类
+static pip_uint8 * arena_class_map = NULL;
+
+static pip_arena_node * arena_free_lists[PIP_ARENA_CLASSES] = {};
+
+static pip_arena_stats arena_stats = {};
+
+/// 尺寸对应的种类 超过最大块返回 -1
+static int arena_class(pip_uint32 size) {
+    pip_uint64 block = PIP_ARENA_SLOT;
+    for (int i = 0; i < PIP_ARENA_CLASSES; i++) {
+        if (size <= block) {
+            return i;
+        }
+        block <<= 1;
+    }
+    return -1;
+}
+
+/// 映射按大页对齐的匿名内存
+static pip_uint8 * arena_map(pip_uint64 size, pip_arena_page * page) {
+    void * ptr = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+        *page = pip_arena_page_huge;
+        return (pip_uint8 *)ptr;
+    }
+#endif
+    
+    /// 多映射一个大页 截掉首尾 保证对齐后内核才能使用透明大页
+    ptr = mmap(NULL, size + PIP_ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+    
+    uintptr_t start = (uintptr_t)ptr;
+    uintptr_t aligned = (start + PIP_ARENA_HUGE_PAGE - 1) & ~((uintptr_t)PIP_ARENA_HUGE_PAGE - 1);
+    if (aligned > start) {
+        munmap(ptr, aligned - start);
+    }
+    
+    uintptr_t tail = start + size + PIP_ARENA_HUGE_PAGE;
+    if (tail > aligned + size) {
+        munmap((void *)(aligned + size), tail - (aligned + size));
+    }
+    
+    *page = pip_arena_page_regular;
+
+#ifdef MADV_HUGEPAGE
+    if (madvise((void *)aligned, size, MADV_HUGEPAGE) == 0) {
+        *page = pip_arena_page_transparent;
+    }
+#endif
+    
+    return (pip_uint8 *)aligned;
+}
+
+bool pip_arena::init(pip_uint64 size) {
+    if (arena_base != NULL || size <= 0) {
+        return false;
+    }
+    
+    size = (size + PIP_ARENA_HUGE_PAGE - 1) & ~((pip_uint64)PIP_ARENA_HUGE_PAGE - 1);
+    
+    pip_uint8 * class_map = (pip_uint8 *)calloc(size / PIP_ARENA_SLOT, sizeof(pip_uint8));
+    if (class_map == NULL) {
+        return false;
+    }
+    
+    pip_arena_page page = pip_arena_page_none;
+    pip_uint8 * base = arena_map(size, &page);
+    if (base == NULL) {
+        ::free(class_map);
+        return false;
+    }
+    
+    arena_base = base;
+    arena_class_map = class_map;
+    arena_stats.size = size;
+    arena_stats.page = page;
+    return true;
+}
+
+void * pip_arena::alloc(pip_uint32 size) {
+    if (arena_base == NULL || size <= 0) {
+        return malloc(size);
+    }
+    
+    int c = arena_class(size);
+    if (c < 0) {
+        arena_stats.fallbacks += 1;
+        return malloc(size);
+    }
+    
+    pip_uint64 block = (pip_uint64)PIP_ARENA_SLOT << c;
+    pip_uint8 * ptr = NULL;
+    
+    if (arena_free_lists[c] != NULL) {
+        pip_arena_node * node = arena_free_lists[c];
+        arena_free_lists[c] = node->next;
+        ptr = (pip_uint8 *)node;
+    
+    } else if (arena_stats.carved + block <= arena_stats.size) {
+        ptr = arena_base + arena_stats.carved;
+        arena_class_map[arena_stats.carved / PIP_ARENA_SLOT] = c;
+        arena_stats.carved += block;
+    
+    } else {
+        arena_stats.fallbacks += 1;
+        return malloc(size);
+    }
+    
+    arena_stats.allocs += 1;
+    arena_stats.in_use += block;
+    return ptr;
+}
+
+void pip_arena::free(void * ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    
+    if (!contains(ptr)) {
+        ::free(ptr);
+        return;
+    }
+    
+    pip_uint64 offset = (pip_uint8 *)ptr - arena_base;
+    int c = arena_class_map[offset / PIP_ARENA_SLOT];
+    
+    pip_arena_node * node = (pip_arena_node *)ptr;
+    node->next = arena_free_lists[c];
+    arena_free_lists[c] = node;
+    
+    arena_stats.in_use -= (pip_uint64)PIP_ARENA_SLOT << c;
+}
+
+bool pip_arena::contains(const void * ptr) {
+    return arena_base != NULL && (const pip_uint8 *)ptr >= arena_base && (const pip_uint8 *)ptr < arena_base + arena_stats.size;
+}
+
+pip_arena_stats pip_arena::get_stats() {
+    return arena_stats;
+}
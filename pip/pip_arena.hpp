@@ -0,0 +1,72 @@
+//
+//  pip_arena.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_arena_hpp
+#define pip_arena_hpp
+
+#include "pip_type.hpp"
+
+/// 内存区使用的页类型
+typedef enum : pip_uint8 {
+    /// 未启用
+    pip_arena_page_none,
+    
+    /// 普通页
+    pip_arena_page_regular,
+    
+    /// 透明大页 由内核合并 不保证全部是大页
+    pip_arena_page_transparent,
+    
+    /// MAP_HUGETLB 预留的大页
+    pip_arena_page_huge,
+} pip_arena_page;
+
+/// 内存区统计
+struct pip_arena_stats {
+    /// 内存区大小
+    pip_uint64 size;
+    
+    /// 已经切分出去的大小 切分后只在同一尺寸内复用
+    pip_uint64 carved;
+    
+    /// 正在使用的大小
+    pip_uint64 in_use;
+    
+    /// 从内存区分配的次数
+    pip_uint64 allocs;
+    
+    /// 内存区用完或尺寸过大 改用 malloc 的次数
+    pip_uint64 fallbacks;
+    
+    pip_arena_page page;
+};
+
+/// 数据包内存区 启动时一次性申请一块大页内存 pip_buf 数据和发送缓冲从这里分配 减少 TLB 缺失
+/// 按 PIP_ARENA_SLOT 的2的幂倍切分 释放的块挂在对应尺寸的空闲链表上复用 不合并
+/// 未启用或用完时退回 malloc 调用方不需要区分
+/// 只在协议栈线程使用 不加锁
+class pip_arena {
+
+public:
+    /// 申请内存区 只能调用一次 一般在创建协议栈时调用
+    /// 之前由 malloc 分配的内存按地址区分 释放时不受影响
+    /// 依次尝试 MAP_HUGETLB 透明大页 普通页
+    /// @param size 内存区大小 向上取大页的整数倍
+    static bool init(pip_uint64 size);
+    
+    /// 分配内存 内容未初始化
+    static void * alloc(pip_uint32 size);
+    
+    /// 释放 alloc 分配的内存
+    static void free(void * ptr);
+    
+    /// 是否属于内存区
+    static bool contains(const void * ptr);
+    
+    static pip_arena_stats get_stats();
+};
+
+#endif /* pip_arena_hpp */
@@ -5,15 +5,40 @@
 //
 
 #include "pip_buf.hpp"
+#include "pip_arena.hpp"
 #include <string.h>
 #include <stdlib.h>
 
+// MARK: - pip_buf_block
+pip_buf_block * pip_buf_block::create(int size) {
+    pip_buf_block * block = (pip_buf_block *)pip_arena::alloc(sizeof(pip_buf_block) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    
+    block->ref = 1;
+    block->size = size;
+    return block;
+}
+
+void pip_buf_block::retain() {
+    this->ref += 1;
+}
+
+void pip_buf_block::release() {
+    this->ref -= 1;
+    if (this->ref <= 0) {
+        pip_arena::free(this);
+    }
+}
+
+// MARK: - pip_buf
 pip_buf::pip_buf(void * payload, int payload_len, int is_copy) {
     
     
     this->payload_len = payload_len;
     if (is_copy && payload_len > 0) {
-        void * b = malloc(sizeof(char) * payload_len);
+        void * b = pip_arena::alloc(sizeof(char) * payload_len);
         memcpy(b, payload, payload_len);
         this->payload = b;
     } else {
@@ -22,6 +47,8 @@ pip_buf::pip_buf(void * payload, int payload_len, int is_copy) {
     
     this->is_alloc = is_copy;
     this->total_len = this->payload_len;
+    this->headroom = 0;
+    this->block = NULL;
     
     this->next = NULL;
     this->pre = NULL;
@@ -29,14 +56,68 @@ pip_buf::pip_buf(void * payload, int payload_len, int is_copy) {
 
 pip_buf::pip_buf(int length) {
     this->is_alloc = 1;
-    this->payload = calloc(length, sizeof(char));
+    this->payload = pip_arena::alloc(length);
+    memset(this->payload, 0, length);
     this->payload_len = length;
     this->total_len = length;
+    this->headroom = 0;
+    this->block = NULL;
     
     this->next = NULL;
     this->pre = NULL;
 }
 
+pip_buf::pip_buf(int headroom, int length) {
+    this->is_alloc = 1;
+    pip_uint8 * b = (pip_uint8 *)pip_arena::alloc(headroom + length);
+    memset(b, 0, headroom + length);
+    this->payload = b + headroom;
+    this->payload_len = length;
+    this->total_len = length;
+    this->headroom = headroom;
+    this->block = NULL;
+    
+    this->next = NULL;
+    this->pre = NULL;
+}
+
+pip_buf::pip_buf(pip_buf_block * block, int offset, int length) {
+    block->retain();
+    
+    this->is_alloc = 0;
+    this->block = block;
+    this->payload = block->data() + offset;
+    this->payload_len = length;
+    this->total_len = length;
+    this->headroom = 0;
+    
+    this->next = NULL;
+    this->pre = NULL;
+}
+
+pip_buf * pip_buf::create_shared(int headroom, int length) {
+    pip_buf_block * block = pip_buf_block::create(headroom + length);
+    if (block == NULL) {
+        return NULL;
+    }
+    
+    pip_buf * buf = new pip_buf(block, headroom, length);
+    buf->headroom = headroom;
+    
+    /// 创建时的引用转交给 buf
+    block->release();
+    return buf;
+}
+
+pip_buf * pip_buf::slice(int offset, int length) {
+    if (this->block == NULL || offset + length > this->payload_len) {
+        return NULL;
+    }
+    
+    int block_offset = (int)((pip_uint8 *)this->payload - this->block->data()) + offset;
+    return new pip_buf(this->block, block_offset, length);
+}
+
 pip_buf::~pip_buf() {
     
     if (this->pre) {
@@ -47,31 +128,74 @@ pip_buf::~pip_buf() {
     
     delete this->next;
     
-    if (this->is_alloc && this->payload_len > 0) {
-        free(this->payload);
+    if (this->block) {
+        this->block->release();
+        this->block = NULL;
+        
+    } else if (this->is_alloc && this->payload_len + this->headroom > 0) {
+        pip_arena::free((pip_uint8 *)this->payload - this->headroom);
     }
     
     this->total_len = 0;
     this->payload_len = 0;
 }
 
-void pip_buf::set_next(pip_buf *buf) {
-    if (buf == NULL) {
-        if (this->next) {
-            this->total_len -= this->next->total_len;
-            this->next->pre = NULL;
-            this->next = NULL;
-        }
-        
-        return;
+void * pip_buf::operator new(size_t) {
+    void * ptr = get_pool()->alloc();
+    if (ptr == NULL) {
+        throw std::bad_alloc();
     }
+    return ptr;
+}
+
+void pip_buf::operator delete(void * ptr) {
+    get_pool()->free(ptr);
+}
+
+pip_pool * pip_buf::get_pool() {
+    /// 不释放 保证晚于所有对象销毁
+    static pip_pool * pool = new pip_pool(sizeof(pip_buf), PIP_POOL_SLAB_OBJECTS);
+    return pool;
+}
+
+void pip_buf::set_next(pip_buf *buf) {
+    int old_len = this->total_len;
     
     if (this->next != NULL) {
         this->total_len -= this->next->total_len;
         this->next->pre = NULL;
+        this->next = NULL;
+    }
+    
+    if (buf != NULL) {
+        this->total_len += buf->total_len;
+        this->next = buf;
+        buf->pre = this;
+    }
+    
+    /// 接在链表中间时 前面各节点的总长度一起更新
+    for (pip_buf * p = this->pre; p != NULL; p = p->pre) {
+        p->total_len += this->total_len - old_len;
     }
+}
+
+bool pip_buf::add_header(int len) {
+    if (len > this->headroom) {
+        return false;
+    }
+    
+    this->payload = (pip_uint8 *)this->payload - len;
+    this->payload_len += len;
+    this->total_len += len;
+    this->headroom -= len;
+    return true;
+}
+
+void pip_buf::remove_header(int len) {
+    len = PIP_MIN(len, this->payload_len);
     
-    this->total_len += buf->total_len;
-    this->next = buf;
-    buf->pre = this;
+    this->payload = (pip_uint8 *)this->payload + len;
+    this->payload_len -= len;
+    this->total_len -= len;
+    this->headroom += len;
 }
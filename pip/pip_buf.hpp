@@ -8,6 +8,24 @@
 #define pip_buf_hpp
 
 #include <stdio.h>
+#include "pip_pool.hpp"
+
+/// 引用计数的数据块 可以被多个 pip_buf 共享 最后一个引用释放时归还内存
+/// 只在协议栈线程使用 不加锁
+struct pip_buf_block {
+    int ref;
+    int size;
+    
+    static pip_buf_block * create(int size);
+    
+    void retain();
+    void release();
+    
+    /// 数据紧跟在结构体后面
+    pip_uint8 * data() {
+        return (pip_uint8 *)(this + 1);
+    }
+};
 
 class pip_buf {
     
@@ -16,11 +34,48 @@ public:
     pip_buf(void * payload, int payload_len, int is_copy);
     pip_buf(int length);
     
+    /// 分配 length 长度的数据 并在前面预留 headroom 用于之后写入头部
+    pip_buf(int headroom, int length);
+    
+    /// 引用数据块中的一段 不复制
+    /// @param block 数据块 引用计数加一
+    /// @param offset 相对数据块起点的偏移
+    /// @param length _
+    pip_buf(pip_buf_block * block, int offset, int length);
+    
+    /// 分配共享数据块 预留 headroom 之后可以用 slice 共享给其他 pip_buf
+    static pip_buf * create_shared(int headroom, int length);
+    
+    /// 共享同一数据块的一段 不复制 没有数据块时返回 NULL
+    /// @param offset 相对 payload 的偏移
+    /// @param length _
+    pip_buf * slice(int offset, int length);
+    
+    /// 从对象池分配
+    static void * operator new(size_t size);
+    static void operator delete(void * ptr);
+    
+    /// 对象池 可以预分配和查看统计
+    static pip_pool * get_pool();
+    
     void set_next(pip_buf *buf);
     
+    /// 使用预留空间在数据前面增加 len 长度的头部 预留空间不足返回 false
+    /// 只能在链表头部使用
+    bool add_header(int len);
+    
+    /// 去掉前面 len 长度的头部 归还到预留空间
+    void remove_header(int len);
+    
     void *payload;
     int payload_len;
     
+    /// payload 前面可用的预留空间
+    int headroom;
+    
+    /// 共享的数据块 payload 指向块内 为空时按 is_alloc 管理 payload
+    pip_buf_block * block;
+    
     int is_alloc;
     int total_len;
     pip_buf *next;
@@ -5,13 +5,25 @@
 //
 
 #include "pip_checksum.hpp"
+#include <string.h>
 
 pip_uint32 pip_fold_uint32(pip_uint32 num) {
     return (num & 0x0000FFFFUL) + (num >> 16);
 }
 
-pip_uint32 pip_standard_checksum(const void * payload, int len, pip_uint32 sum) {
-    const pip_uint8 * ptr = (const pip_uint8 *)payload;
+/// 64位累加值折叠到16位
+static pip_uint32 pip_fold_uint64(pip_uint64 sum) {
+    sum = (sum & 0xFFFFFFFFULL) + (sum >> 32);
+    sum = (sum & 0xFFFFFFFFULL) + (sum >> 32);
+    pip_uint32 num = pip_fold_uint32((pip_uint32)sum);
+    return pip_fold_uint32(num);
+}
+
+/// 每个实现返回数据按网络字节序16位累加 折叠后的部分和
+typedef pip_uint32 (*pip_checksum_func) (const pip_uint8 * ptr, int len);
+
+static pip_uint32 checksum_reference(const pip_uint8 * ptr, int len) {
+    pip_uint32 sum = 0;
     
     int i = 0;
     while (i < len) {
@@ -32,6 +44,216 @@ pip_uint32 pip_standard_checksum(const void * payload, int len, pip_uint32 sum)
     return sum;
 }
 
+/// 按本机字节序累加 64位累加值 剩余不足8字节的部分
+/// 反码和与字节序无关 最后交换一次高低字节即可得到网络字节序的和 RFC 1071
+static pip_uint64 checksum_tail(const pip_uint8 * ptr, int len, pip_uint64 sum) {
+    while (len >= 4) {
+        pip_uint32 word;
+        memcpy(&word, ptr, sizeof(word));
+        sum += word;
+        ptr += 4;
+        len -= 4;
+    }
+    
+    if (len >= 2) {
+        pip_uint16 word;
+        memcpy(&word, ptr, sizeof(word));
+        sum += word;
+        ptr += 2;
+        len -= 2;
+    }
+    
+    if (len > 0) {
+        /// 最后一个字节是16位字的高位 按本机字节序放到对应位置
+        pip_uint8 word[2] = { ptr[0], 0 };
+        pip_uint16 value;
+        memcpy(&value, word, sizeof(value));
+        sum += value;
+    }
+    
+    return sum;
+}
+
+/// 本机字节序的64位累加值转为网络字节序的16位部分和
+static pip_uint32 checksum_finish_native(pip_uint64 sum) {
+    return ntohs((pip_uint16)pip_fold_uint64(sum));
+}
+
+static pip_uint32 checksum_scalar64(const pip_uint8 * ptr, int len) {
+    pip_uint64 sum = 0;
+    while (len >= 8) {
+        pip_uint64 word;
+        memcpy(&word, ptr, sizeof(word));
+        sum += (word & 0xFFFFFFFFULL) + (word >> 32);
+        ptr += 8;
+        len -= 8;
+    }
+    
+    return checksum_finish_native(checksum_tail(ptr, len, sum));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIP_CHECKSUM_X86 1
+#include <immintrin.h>
+
+/// 每次16字节 32位字扩展到64位通道累加 不会溢出
+__attribute__((target("sse2")))
+static pip_uint32 checksum_sse2(const pip_uint8 * ptr, int len) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    while (len >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)ptr);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+        ptr += 16;
+        len -= 16;
+    }
+    
+    pip_uint64 lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    
+    pip_uint64 sum = 0;
+    sum += (lanes[0] & 0xFFFFFFFFULL) + (lanes[0] >> 32);
+    sum += (lanes[1] & 0xFFFFFFFFULL) + (lanes[1] >> 32);
+    return checksum_finish_native(checksum_tail(ptr, len, sum));
+}
+
+/// 每次32字节 和 SSE2 相同
+__attribute__((target("avx2")))
+static pip_uint32 checksum_avx2(const pip_uint8 * ptr, int len) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    while (len >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(v, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(v, zero));
+        ptr += 32;
+        len -= 32;
+    }
+    
+    pip_uint64 lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    
+    pip_uint64 sum = 0;
+    for (int i = 0; i < 4; i++) {
+        sum += (lanes[i] & 0xFFFFFFFFULL) + (lanes[i] >> 32);
+    }
+    return checksum_finish_native(checksum_tail(ptr, len, sum));
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIP_CHECKSUM_NEON 1
+#include <arm_neon.h>
+
+/// 每次16字节 32位字成对累加到64位通道
+static pip_uint32 checksum_neon(const pip_uint8 * ptr, int len) {
+    uint64x2_t acc = vdupq_n_u64(0);
+    while (len >= 16) {
+        acc = vpadalq_u32(acc, vreinterpretq_u32_u8(vld1q_u8(ptr)));
+        ptr += 16;
+        len -= 16;
+    }
+    
+    pip_uint64 lo = vgetq_lane_u64(acc, 0);
+    pip_uint64 hi = vgetq_lane_u64(acc, 1);
+    
+    pip_uint64 sum = 0;
+    sum += (lo & 0xFFFFFFFFULL) + (lo >> 32);
+    sum += (hi & 0xFFFFFFFFULL) + (hi >> 32);
+    return checksum_finish_native(checksum_tail(ptr, len, sum));
+}
+#endif
+
+/// 当前 CPU 是否支持
+static pip_checksum_func checksum_kernel_func(pip_checksum_kernel kernel) {
+    switch (kernel) {
+        case pip_checksum_kernel_reference:
+            return checksum_reference;
+            
+        case pip_checksum_kernel_scalar64:
+            return checksum_scalar64;
+            
+#if PIP_CHECKSUM_X86
+        case pip_checksum_kernel_sse2:
+#if defined(__x86_64__) || defined(__SSE2__)
+            return checksum_sse2;
+#else
+            return __builtin_cpu_supports("sse2") ? checksum_sse2 : NULL;
+#endif
+            
+        case pip_checksum_kernel_avx2:
+            return __builtin_cpu_supports("avx2") ? checksum_avx2 : NULL;
+#endif
+            
+#if PIP_CHECKSUM_NEON
+        case pip_checksum_kernel_neon:
+            return checksum_neon;
+#endif
+            
+        default:
+            return NULL;
+    }
+}
+
+/// 按速度从快到慢选择第一个支持的实现
+static pip_checksum_kernel checksum_detect_kernel() {
+    const pip_checksum_kernel kernels[] = {
+        pip_checksum_kernel_avx2,
+        pip_checksum_kernel_neon,
+        pip_checksum_kernel_sse2,
+        pip_checksum_kernel_scalar64,
+    };
+    
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (checksum_kernel_func(kernels[i]) != NULL) {
+            return kernels[i];
+        }
+    }
+    return pip_checksum_kernel_reference;
+}
+
+static pip_checksum_kernel checksum_kernel = checksum_detect_kernel();
+static pip_checksum_func checksum_func = checksum_kernel_func(checksum_kernel);
+
+pip_checksum_kernel pip_checksum_get_kernel() {
+    return checksum_kernel;
+}
+
+bool pip_checksum_set_kernel(pip_checksum_kernel kernel) {
+    pip_checksum_func func = checksum_kernel_func(kernel);
+    if (func == NULL) {
+        return false;
+    }
+    
+    checksum_kernel = kernel;
+    checksum_func = func;
+    return true;
+}
+
+const char * pip_checksum_kernel_name(pip_checksum_kernel kernel) {
+    switch (kernel) {
+        case pip_checksum_kernel_reference: return "reference";
+        case pip_checksum_kernel_scalar64: return "scalar64";
+        case pip_checksum_kernel_sse2: return "sse2";
+        case pip_checksum_kernel_avx2: return "avx2";
+        case pip_checksum_kernel_neon: return "neon";
+        default: return "unknown";
+    }
+}
+
+pip_uint32 pip_standard_checksum(const void * payload, int len, pip_uint32 sum) {
+    if (len <= 0) {
+        return sum;
+    }
+    
+    sum = pip_fold_uint32(sum);
+    sum += checksum_func((const pip_uint8 *)payload, len);
+    sum = pip_fold_uint32(sum);
+    sum = pip_fold_uint32(sum);
+    return sum;
+}
+
 pip_uint16 pip_ip_checksum(const void * payload, int len) {
     
     pip_uint32 sum = pip_standard_checksum(payload, len, 0);
@@ -61,27 +283,65 @@ pip_uint16 pip_inet_checksum(const void * payload, pip_uint8 proto, pip_uint32 s
 
 
 pip_uint16 pip_inet_checksum_buf(pip_buf * buf, pip_uint8 proto, pip_uint32 src, pip_uint32 dest) {
+    pip_uint32 sum = pip_inet_pseudo_sum(proto, src, dest);
+    sum += (pip_uint16)buf->total_len;
+    sum += pip_buf_checksum_sum(buf);
+    return pip_checksum_finish(sum);
+}
+
+pip_uint32 pip_inet_pseudo_sum(pip_uint8 proto, pip_uint32 src, pip_uint32 dest) {
     pip_uint32 sum = 0;
-    sum += ((pip_uint32)src & 0xFFFF0000) >> 16;
-    sum += ((pip_uint32)src & 0x00000FFFF) >> 0;
-    pip_fold_uint32(sum);
-    
-    sum += ((pip_uint32)dest & 0xFFFF0000) >> 16;
-    sum += ((pip_uint32)dest & 0x00000FFFF) >> 0;
-    pip_fold_uint32(sum);
-    
+    sum += (src >> 16) + (src & 0xFFFF);
+    sum += (dest >> 16) + (dest & 0xFFFF);
     sum += proto;
-    pip_fold_uint32(sum);
-    
-    sum += (pip_uint16)buf->total_len;
-    pip_fold_uint32(sum);
-    
+    return pip_fold_uint32(sum);
+}
+
+pip_uint32 pip_buf_checksum_sum(pip_buf * buf) {
+    pip_uint32 sum = 0;
     
+    /// 链表中的 buf 可能是奇数长度 从奇数偏移开始的 buf 部分和需要交换高低字节
+    pip_uint32 offset = 0;
     for (pip_buf * q = buf; q != NULL; q = q->next) {
-        sum = pip_standard_checksum(q->payload, q->payload_len, sum);
+        pip_uint32 part = pip_standard_checksum(q->payload, q->payload_len, 0);
+        if (offset & 1) {
+            part = ((part & 0xFF) << 8) | ((part >> 8) & 0xFF);
+        }
+        
+        sum += part;
+        sum = pip_fold_uint32(sum);
+        sum = pip_fold_uint32(sum);
+        offset += q->payload_len;
     }
+    
+    return sum;
+}
 
-    return ~((pip_uint16)sum);
+pip_uint16 pip_checksum_fold(pip_uint32 sum) {
+    sum = pip_fold_uint32(sum);
+    sum = pip_fold_uint32(sum);
+    return (pip_uint16)sum;
+}
+
+pip_uint16 pip_checksum_finish(pip_uint32 sum) {
+    return ~pip_checksum_fold(sum);
+}
+
+pip_uint16 pip_checksum_adjust16(pip_uint16 checksum, pip_uint16 old_value, pip_uint16 new_value) {
+    /// HC' = ~(~HC + ~m + m')
+    pip_uint32 sum = (pip_uint16)~checksum;
+    sum += (pip_uint16)~old_value;
+    sum += new_value;
+    return pip_checksum_finish(sum);
+}
+
+pip_uint16 pip_checksum_adjust32(pip_uint16 checksum, pip_uint32 old_value, pip_uint32 new_value) {
+    pip_uint32 sum = (pip_uint16)~checksum;
+    sum += (pip_uint16)~(old_value >> 16);
+    sum += (pip_uint16)~(old_value & 0xFFFF);
+    sum += new_value >> 16;
+    sum += new_value & 0xFFFF;
+    return pip_checksum_finish(sum);
 }
 
 
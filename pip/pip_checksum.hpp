@@ -10,12 +10,36 @@
 #include "pip_type.hpp"
 #include "pip_buf.hpp"
 
-/// 计算checksum
+/// checksum 实现
+typedef enum : pip_uint8 {
+    /// 逐个16位累加 作为对比基准
+    pip_checksum_kernel_reference,
+    
+    /// 64位累加
+    pip_checksum_kernel_scalar64,
+    
+    pip_checksum_kernel_sse2,
+    pip_checksum_kernel_avx2,
+    pip_checksum_kernel_neon,
+    
+    pip_checksum_kernel_count,
+} pip_checksum_kernel;
+
+/// 计算checksum 按 CPU 支持的指令选择最快的实现
 /// @param payload payload
 /// @param len len
 /// @param sum 初始值
 pip_uint32 pip_standard_checksum(const void * payload, int len, pip_uint32 sum);
 
+/// 当前使用的实现
+pip_checksum_kernel pip_checksum_get_kernel();
+
+/// 指定实现 用于对比测试 当前 CPU 不支持返回 false
+bool pip_checksum_set_kernel(pip_checksum_kernel kernel);
+
+/// 实现名称
+const char * pip_checksum_kernel_name(pip_checksum_kernel kernel);
+
 /// 计算IP checksum
 /// @param payload payload
 /// @param len len
@@ -30,4 +54,30 @@ pip_uint16 pip_ip_checksum(const void * payload, int len);
 pip_uint16 pip_inet_checksum(const void * payload, pip_uint8 proto, pip_uint32 src, pip_uint32 dest, pip_uint16 len);
 
 pip_uint16 pip_inet_checksum_buf(pip_buf * buf, pip_uint8 proto, pip_uint32 src, pip_uint32 dest);
+
+/// 伪头部中地址和协议的部分和 不包含长度 同一个连接不变 可以预先计算
+/// @param proto TCP / UDP
+/// @param src 主机字节序
+/// @param dest 主机字节序
+pip_uint32 pip_inet_pseudo_sum(pip_uint8 proto, pip_uint32 src, pip_uint32 dest);
+
+/// buf 链表数据的部分和 未取反
+/// @param buf 链表起始 需要位于数据包的偶数偏移
+pip_uint32 pip_buf_checksum_sum(pip_buf * buf);
+
+/// 折叠部分和到16位 不取反 校验和卸载时填入伪头部的和
+pip_uint16 pip_checksum_fold(pip_uint32 sum);
+
+/// 折叠部分和并取反 得到最终的校验和 主机字节序
+pip_uint16 pip_checksum_finish(pip_uint32 sum);
+
+/// 头部中一个16位字段改变后更新校验和 不需要重新计算整个数据包 RFC 1624
+/// 参数都是头部中保存的原值 字节序一致即可
+/// @param checksum 原校验和
+/// @param old_value 字段原值
+/// @param new_value 字段新值
+pip_uint16 pip_checksum_adjust16(pip_uint16 checksum, pip_uint16 old_value, pip_uint16 new_value);
+
+/// 32位字段改变后更新校验和 同 pip_checksum_adjust16
+pip_uint16 pip_checksum_adjust32(pip_uint16 checksum, pip_uint32 old_value, pip_uint32 new_value);
 #endif /* pip_checksum_hpp */
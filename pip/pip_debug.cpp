@@ -8,6 +8,7 @@
 #include "pip_debug.hpp"
 
 void pip_debug_output_iden(const char *iden) {
+    PIP_UNUSED(iden);
 #if PIP_DEBUG
     printf("[%s]: \n", iden);
 #endif
@@ -17,6 +18,8 @@ void pip_debug_output_iden(const char *iden) {
 /// @param hdr _
 /// @param iden 标识
 void pip_debug_output_ip(struct ip *hdr, const char *iden) {
+    PIP_UNUSED(hdr);
+    PIP_UNUSED(iden);
     
 #if PIP_DEBUG
     pip_debug_output_iden(iden);
@@ -42,6 +45,8 @@ void pip_debug_output_ip(struct ip *hdr, const char *iden) {
 /// @param hdr _
 /// @param iden 标识
 void pip_debug_output_udp(struct udphdr *hdr, const char *iden) {
+    PIP_UNUSED(hdr);
+    PIP_UNUSED(iden);
     
 #if PIP_DEBUG
     pip_debug_output_iden(iden);
@@ -60,6 +65,9 @@ void pip_debug_output_udp(struct udphdr *hdr, const char *iden) {
 /// @param packet _
 /// @param iden _
 void pip_debug_output_tcp(pip_tcp * tcp, pip_tcp_packet * packet, const char *iden) {
+    PIP_UNUSED(tcp);
+    PIP_UNUSED(packet);
+    PIP_UNUSED(iden);
     
 #if PIP_DEBUG
     tcphdr * hdr = packet->get_hdr();
@@ -69,18 +77,19 @@ void pip_debug_output_tcp(pip_tcp * tcp, pip_tcp_packet * packet, const char *id
 }
 
 void pip_debug_output_tcp(pip_tcp * tcp, struct tcphdr *hdr, pip_uint32 datalen, const char *iden) {
+    PIP_UNUSED(tcp);
+    PIP_UNUSED(hdr);
+    PIP_UNUSED(datalen);
+    PIP_UNUSED(iden);
     
 #if PIP_DEBUG
     if (tcp == NULL) {
         return;
     }
     
-    pip_ip_header * ip_header = tcp->ip_header;
     pip_debug_output_iden(iden);
-    if (ip_header) {
-        printf("src %s port %u\n", ip_header->src_str, tcp->src_port);
-        printf("dst %s port %u\n", ip_header->dest_str, tcp->dest_port);
-    }
+    printf("src %s port %u\n", pip_ip_to_str(tcp->src_ip).str, tcp->src_port);
+    printf("dst %s port %u\n", pip_ip_to_str(tcp->dest_ip).str, tcp->dest_port);
     
     printf("iden: %u\n", tcp->get_iden());
     
@@ -136,6 +145,8 @@ void pip_debug_output_tcp(pip_tcp * tcp, struct tcphdr *hdr, pip_uint32 datalen,
 /// @param hdr _
 /// @param iden _
 void pip_debug_output_icmp(struct icmp *hdr, const char *iden) {
+    PIP_UNUSED(hdr);
+    PIP_UNUSED(iden);
     
 #if PIP_DEBUG
     if (hdr == NULL) {
@@ -0,0 +1,224 @@
+//
+//  pip_flow_table.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_flow_table_hpp
+#define pip_flow_table_hpp
+
+#include "pip_type.hpp"
+
+/// 连接四元组
+struct pip_flow_key {
+    pip_uint32 src;
+    pip_uint32 dest;
+    pip_uint16 src_port;
+    pip_uint16 dest_port;
+
+    bool operator == (const pip_flow_key & other) const {
+        return this->src == other.src &&
+        this->dest == other.dest &&
+        this->src_port == other.src_port &&
+        this->dest_port == other.dest_port;
+    }
+};
+
+static inline pip_uint64 pip_flow_mix64(pip_uint64 x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/// 计算四元组hash 带随机种子 防止构造碰撞
+static inline pip_uint32 pip_flow_hash(const pip_flow_key & key, pip_uint64 seed) {
+    pip_uint64 a = ((pip_uint64)key.src << 32) | key.dest;
+    pip_uint64 b = ((pip_uint64)key.src_port << 16) | key.dest_port;
+    pip_uint64 h = pip_flow_mix64(a ^ seed);
+    h = pip_flow_mix64(h ^ (b + 0x9e3779b97f4a7c15ULL));
+    return (pip_uint32)(h >> 32);
+}
+
+/// 四元组连接表
+/// 开放寻址 + Robin Hood 探测，删除时向前搬移 不产生墓碑
+/// T 必须是指针类型 NULL 表示空槽
+template <class T>
+class pip_flow_table {
+
+    struct slot {
+        pip_flow_key key;
+        pip_uint32 hash;
+        T value;
+    };
+
+public:
+    pip_flow_table() {
+        this->_size = 0;
+        this->_mask = 0;
+        this->_slots = NULL;
+        this->_seed = pip_flow_mix64(get_current_time() ^ (pip_uint64)(uintptr_t)this);
+        this->resize(64);
+    };
+
+    ~pip_flow_table() {
+        free(this->_slots);
+        this->_slots = NULL;
+    };
+
+    /// 计算四元组hash
+    pip_uint32 hash(const pip_flow_key & key) {
+        return pip_flow_hash(key, this->_seed);
+    };
+
+    /// 查找连接 不存在返回NULL
+    T find(const pip_flow_key & key) {
+        pip_uint32 h = this->hash(key);
+        pip_uint32 idx = h & this->_mask;
+        pip_uint32 dist = 0;
+
+        while (true) {
+            slot * s = &this->_slots[idx];
+            if (s->value == NULL || this->probe_distance(s->hash, idx) < dist) {
+                return NULL;
+            }
+
+            if (s->hash == h && s->key == key) {
+                return s->value;
+            }
+
+            idx = (idx + 1) & this->_mask;
+            dist += 1;
+        }
+    };
+
+    /// 插入连接 已存在则覆盖
+    void insert(const pip_flow_key & key, T value) {
+        if ((this->_size + 1) * 4 > (this->_mask + 1) * 3) {
+            this->resize((this->_mask + 1) * 2);
+        }
+
+        if (this->insert_slot(key, this->hash(key), value)) {
+            this->_size += 1;
+        }
+    };
+
+    /// 删除连接 返回被删除的值
+    T remove(const pip_flow_key & key) {
+        pip_uint32 h = this->hash(key);
+        pip_uint32 idx = h & this->_mask;
+        pip_uint32 dist = 0;
+
+        while (true) {
+            slot * s = &this->_slots[idx];
+            if (s->value == NULL || this->probe_distance(s->hash, idx) < dist) {
+                return NULL;
+            }
+
+            if (s->hash == h && s->key == key) {
+                break;
+            }
+
+            idx = (idx + 1) & this->_mask;
+            dist += 1;
+        }
+
+        T value = this->_slots[idx].value;
+
+        /// 后续元素向前搬移 直到遇到空槽或已在理想位置的元素
+        pip_uint32 next = (idx + 1) & this->_mask;
+        while (this->_slots[next].value != NULL && this->probe_distance(this->_slots[next].hash, next) > 0) {
+            this->_slots[idx] = this->_slots[next];
+            idx = next;
+            next = (next + 1) & this->_mask;
+        }
+
+        this->_slots[idx].value = NULL;
+        this->_size -= 1;
+        return value;
+    };
+
+    pip_uint32 size() {
+        return this->_size;
+    };
+
+    /// 槽数量 配合 value_at 遍历
+    pip_uint32 capacity() {
+        return this->_mask + 1;
+    };
+
+    /// 获取槽中的值 空槽返回NULL
+    T value_at(pip_uint32 idx) {
+        return this->_slots[idx].value;
+    };
+
+private:
+
+    pip_uint32 probe_distance(pip_uint32 hash, pip_uint32 idx) {
+        return (idx - (hash & this->_mask)) & this->_mask;
+    };
+
+    /// 返回是否新增
+    bool insert_slot(pip_flow_key key, pip_uint32 h, T value) {
+        pip_uint32 idx = h & this->_mask;
+        pip_uint32 dist = 0;
+
+        while (true) {
+            slot * s = &this->_slots[idx];
+            if (s->value == NULL) {
+                s->key = key;
+                s->hash = h;
+                s->value = value;
+                return true;
+            }
+
+            if (s->hash == h && s->key == key) {
+                s->value = value;
+                return false;
+            }
+
+            /// 抢占探测距离更短的槽
+            pip_uint32 s_dist = this->probe_distance(s->hash, idx);
+            if (s_dist < dist) {
+                slot tmp = *s;
+                s->key = key;
+                s->hash = h;
+                s->value = value;
+
+                key = tmp.key;
+                h = tmp.hash;
+                value = tmp.value;
+                dist = s_dist;
+            }
+
+            idx = (idx + 1) & this->_mask;
+            dist += 1;
+        }
+    };
+
+    void resize(pip_uint32 capacity) {
+        slot * old_slots = this->_slots;
+        pip_uint32 old_capacity = old_slots ? this->_mask + 1 : 0;
+
+        this->_slots = (slot *)calloc(capacity, sizeof(slot));
+        this->_mask = capacity - 1;
+
+        for (pip_uint32 i = 0; i < old_capacity; i++) {
+            if (old_slots[i].value != NULL) {
+                this->insert_slot(old_slots[i].key, old_slots[i].hash, old_slots[i].value);
+            }
+        }
+
+        free(old_slots);
+    };
+
+private:
+    slot * _slots;
+    pip_uint32 _mask;
+    pip_uint32 _size;
+    pip_uint64 _seed;
+};
+
+#endif /* pip_flow_table_hpp */
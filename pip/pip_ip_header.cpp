@@ -6,8 +6,44 @@
 //
 
 #include "pip_ip_header.hpp"
+#include "pip_checksum.hpp"
+#include <string.h>
 
 
+pip_ip_str pip_ip_to_str(pip_uint32 addr) {
+    pip_ip_str ip_str;
+    struct in_addr in;
+    in.s_addr = htonl(addr);
+    inet_ntop(AF_INET, &in, ip_str.str, sizeof(ip_str.str));
+    return ip_str;
+}
+
+void pip_ip_template::init(pip_uint8 proto, pip_uint32 src, pip_uint32 dest) {
+    memset(&this->hdr, 0, sizeof(struct ip));
+    this->hdr.ip_v = 4;
+    this->hdr.ip_hl = 5;
+    this->hdr.ip_tos = 0;
+    this->hdr.ip_off = htons(IP_DF);
+    this->hdr.ip_ttl = 64;
+    this->hdr.ip_p = proto;
+    this->hdr.ip_src.s_addr = htonl(src);
+    this->hdr.ip_dst.s_addr = htonl(dest);
+    
+    /// ip_len ip_id ip_sum 为0 不影响部分和
+    this->sum = pip_standard_checksum(&this->hdr, sizeof(struct ip), 0);
+}
+
+pip_ip_header::pip_ip_header() {
+    this->version = 0;
+    this->protocol = 0;
+    this->has_options = 0;
+    this->headerlen = 0;
+    this->datalen = 0;
+    this->src = 0;
+    this->dest = 0;
+    this->checksum_valid = false;
+}
+
 pip_ip_header::pip_ip_header(const void * bytes) {
     
     struct ip *hdr = (struct ip*)bytes;
@@ -21,33 +57,16 @@ pip_ip_header::pip_ip_header(const void * bytes) {
         
         this->src = ntohl(hdr->ip_src.s_addr);
         this->dest = ntohl(hdr->ip_dst.s_addr);
-        
-        this->src_str = (char *)calloc(INET_ADDRSTRLEN, sizeof(char));
-        this->dest_str = (char *)calloc(INET_ADDRSTRLEN, sizeof(char));
-        
-        inet_ntop(AF_INET, &hdr->ip_src.s_addr, this->src_str, INET_ADDRSTRLEN);
-        inet_ntop(AF_INET, &hdr->ip_dst.s_addr, this->dest_str, INET_ADDRSTRLEN);
+        this->checksum_valid = false;
         
     } else {
         this->version = 6;
-        
-        this->src_str = NULL;
-        this->dest_str = NULL;
-    }
-}
-
-
-
-pip_ip_header::~pip_ip_header() {
-    
-    
-    if (this->src_str != NULL) {
-        free(this->src_str);
-        this->src_str = NULL;
-    }
-    
-    if (this->dest_str != NULL) {
-        free(this->dest_str);
-        this->dest_str = NULL;
+        this->protocol = 0;
+        this->has_options = 0;
+        this->headerlen = 0;
+        this->datalen = 0;
+        this->src = 0;
+        this->dest = 0;
+        this->checksum_valid = false;
     }
 }
@@ -10,11 +10,49 @@
 
 #include "pip_type.hpp"
 
+/// 二进制地址和端口 网络字节序
+struct pip_addr {
+    /// IP协议版本 4 || 6
+    pip_uint8 version;
+    
+    pip_uint16 port;
+    
+    union {
+        pip_uint32 v4;
+        pip_uint8 v6[16];
+    } ip;
+};
+
+/// IP地址字符串
+struct pip_ip_str {
+    char str[INET6_ADDRSTRLEN];
+};
+
+/// 格式化IPv4地址 只在需要显示时调用
+/// @param addr 主机字节序
+pip_ip_str pip_ip_to_str(pip_uint32 addr);
+
+/// 预先填充的IPv4头部 同一个连接除总长度 标识 校验和外都不变
+struct pip_ip_template {
+    /// 网络字节序 ip_len ip_id ip_sum 输出时填充
+    struct ip hdr;
+    
+    /// 不变字段的校验和部分和 未取反
+    pip_uint32 sum;
+    
+    /// 填充不变字段并计算部分和
+    /// @param proto _
+    /// @param src 主机字节序
+    /// @param dest 主机字节序
+    void init(pip_uint8 proto, pip_uint32 src, pip_uint32 dest);
+};
+
+/// 解析后的IP头部 值类型 在栈上使用 不申请内存
 class pip_ip_header {
     
 public:
+    pip_ip_header();
     pip_ip_header(const void * bytes);
-    ~pip_ip_header();
     
     /// 版本号
     pip_uint8 version;
@@ -31,11 +69,12 @@ public:
     /// 携带数据长度
     pip_uint16 datalen;
     
+    /// 主机字节序
     pip_uint32 src;
     pip_uint32 dest;
     
-    char * src_str;
-    char * dest_str;
+    /// 链路层已经验证过 TCP UDP 校验和
+    bool checksum_valid;
     
 };
 #endif /* pip_ip_header_hpp */
@@ -0,0 +1,46 @@
+//
+//  pip_mem.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_mem.hpp"
+
+static pip_mem_stats mem_stats = { PIP_MEM_BUDGET, 0, { 0 }, 0, 0 };
+
+bool pip_mem::charge(pip_mem_type type, pip_uint64 bytes) {
+    if (!available(bytes)) {
+        mem_stats.refused += 1;
+        return false;
+    }
+    
+    mem_stats.used += bytes;
+    mem_stats.type_used[type] += bytes;
+    return true;
+}
+
+void pip_mem::uncharge(pip_mem_type type, pip_uint64 bytes) {
+    bytes = PIP_MIN(bytes, mem_stats.type_used[type]);
+    mem_stats.used -= bytes;
+    mem_stats.type_used[type] -= bytes;
+}
+
+bool pip_mem::available(pip_uint64 bytes) {
+    return mem_stats.used + bytes <= mem_stats.budget;
+}
+
+bool pip_mem::is_pressured() {
+    return mem_stats.used >= mem_stats.budget / 4 * 3;
+}
+
+void pip_mem::refuse_syn() {
+    mem_stats.refused_syns += 1;
+}
+
+void pip_mem::set_budget(pip_uint64 budget) {
+    mem_stats.budget = budget;
+}
+
+pip_mem_stats pip_mem::get_stats() {
+    return mem_stats;
+}
@@ -0,0 +1,70 @@
+//
+//  pip_mem.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_mem_hpp
+#define pip_mem_hpp
+
+#include "pip_type.hpp"
+
+/// 内存记账类型
+typedef enum : pip_uint8 {
+    /// TCP 连接对象
+    pip_mem_type_tcp_conn,
+    
+    /// TCP 发送缓冲和借出缓冲
+    pip_mem_type_tcp_snd,
+    
+    /// TCP 乱序重组队列
+    pip_mem_type_tcp_reass,
+    
+    pip_mem_type_count,
+} pip_mem_type;
+
+/// 内存使用统计
+struct pip_mem_stats {
+    /// 总预算
+    pip_uint64 budget;
+    
+    /// 当前使用
+    pip_uint64 used;
+    
+    /// 按类型的使用
+    pip_uint64 type_used[pip_mem_type_count];
+    
+    /// 超出预算被拒绝的申请次数
+    pip_uint64 refused;
+    
+    /// 超出预算被拒绝的新连接
+    pip_uint64 refused_syns;
+};
+
+/// 协议栈全局内存预算 所有连接的发送缓冲 乱序队列和连接对象都在这里记账
+/// 超过预算时写入返回0 新的 SYN 被拒绝 超过软限制时每个连接的发送缓冲收缩到 PIP_TCP_SND_BUF_SOFT
+class pip_mem {
+    
+public:
+    /// 申请记账 超出预算返回 false 不记账
+    static bool charge(pip_mem_type type, pip_uint64 bytes);
+    
+    /// 归还记账
+    static void uncharge(pip_mem_type type, pip_uint64 bytes);
+    
+    /// 是否还可以申请 bytes
+    static bool available(pip_uint64 bytes);
+    
+    /// 是否超过软限制
+    static bool is_pressured();
+    
+    /// 记录一次被拒绝的新连接
+    static void refuse_syn();
+    
+    /// 设置总预算 默认 PIP_MEM_BUDGET 已使用的不受影响
+    static void set_budget(pip_uint64 budget);
+    
+    static pip_mem_stats get_stats();
+};
+
+#endif /* pip_mem_hpp */
@@ -12,8 +12,12 @@
 #include "pip_checksum.hpp"
 #include <iostream>
 #include <mutex>
+#include <string.h>
 #include "pip_ip_header.hpp"
 #include "pip_debug.hpp"
+#include "pip_arena.hpp"
+#include "pip_vnet_hdr.hpp"
+#include "pip_flow_table.hpp"
 
 using namespace std;
 
@@ -27,7 +31,18 @@ pip_netif::pip_netif() {
     this->output_ip_data_callback = NULL;
     this->new_tcp_connect_callback = NULL;
     this->received_udp_data_callback = NULL;
+    this->received_udp_packet_callback = NULL;
     
+    this->_output_buf = NULL;
+    this->_output_busy = false;
+    this->_checksum_offload = false;
+    this->_verify_checksum = PIP_NETIF_VERIFY_CHECKSUM;
+    this->_output_merge = PIP_NETIF_OUTPUT_MERGE;
+    memset(&this->_stats, 0, sizeof(pip_netif_stats));
+    
+#if PIP_ARENA_SIZE > 0
+    pip_arena::init(PIP_ARENA_SIZE);
+#endif
 }
 
 pip_netif * pip_netif::shared() {
@@ -44,27 +59,120 @@ pip_netif * pip_netif::shared() {
 }
 
 void pip_netif::input(const void *buffer) {
+    pip_ip_header ip_header;
+    if (this->parse_input(&buffer, PIP_UINT32_MAX, &ip_header)) {
+        this->dispatch_input(buffer, &ip_header);
+    }
+}
+
+void pip_netif::input_batch(const void * const * packets, const pip_uint32 * lengths, int count) {
+    while (count > PIP_NETIF_BATCH_MAX) {
+        this->input_batch(packets, lengths, PIP_NETIF_BATCH_MAX);
+        packets += PIP_NETIF_BATCH_MAX;
+        lengths += PIP_NETIF_BATCH_MAX;
+        count -= PIP_NETIF_BATCH_MAX;
+    }
+    
+    const void * buffers[PIP_NETIF_BATCH_MAX];
+    pip_ip_header headers[PIP_NETIF_BATCH_MAX];
+    pip_flow_key keys[PIP_NETIF_BATCH_MAX];
+    bool done[PIP_NETIF_BATCH_MAX];
+    int n = 0;
+    
+    /// 先集中解析校验 处理当前包时预取下一个包的头部
+    for (int i = 0; i < count; i++) {
+        if (i + 1 < count) {
+            __builtin_prefetch(packets[i + 1]);
+        }
+        
+        const void * buffer = packets[i];
+        if (!this->parse_input(&buffer, lengths[i], &headers[n])) {
+            continue;
+        }
+        
+        if (headers[n].protocol == IPPROTO_TCP) {
+            const struct tcphdr * hdr = (const struct tcphdr *)((const pip_uint8 *)buffer + headers[n].headerlen);
+            keys[n].src = headers[n].src;
+            keys[n].dest = headers[n].dest;
+            keys[n].src_port = hdr->th_sport;
+            keys[n].dest_port = hdr->th_dport;
+        }
+        
+        buffers[n] = buffer;
+        done[n] = false;
+        n++;
+    }
+    
+    /// 同一连接的包紧接着处理 连接内保持到达顺序 立即确认和乱序的重复确认挂起到批次结束
+    pip_tcp::begin_batch();
+    for (int i = 0; i < n; i++) {
+        if (done[i]) {
+            continue;
+        }
+        
+        this->dispatch_input(buffers[i], &headers[i]);
+        if (headers[i].protocol != IPPROTO_TCP) {
+            continue;
+        }
+        
+        for (int j = i + 1; j < n; j++) {
+            if (!done[j] && headers[j].protocol == IPPROTO_TCP && keys[j] == keys[i]) {
+                this->dispatch_input(buffers[j], &headers[j]);
+                done[j] = true;
+            }
+        }
+    }
+    pip_tcp::end_batch();
+}
+
+bool pip_netif::parse_input(const void ** buffer, pip_uint32 length, pip_ip_header * ip_header) {
+    bool checksum_valid = false;
+    if (this->_checksum_offload) {
+        if (length < sizeof(pip_vnet_hdr)) {
+            this->_stats.bad_length += 1;
+            return false;
+        }
+        
+        /// 内核已经验证过 或者是本机发出的只有部分校验和的包 都不需要再校验
+        const pip_vnet_hdr * vnet_hdr = (const pip_vnet_hdr *)*buffer;
+        checksum_valid = vnet_hdr->flags & (PIP_VNET_HDR_F_DATA_VALID | PIP_VNET_HDR_F_NEEDS_CSUM);
+        *buffer = (const pip_uint8 *)*buffer + sizeof(pip_vnet_hdr);
+        length -= sizeof(pip_vnet_hdr);
+    }
+    
+    if (length < sizeof(struct ip)) {
+        this->_stats.bad_length += 1;
+        return false;
+    }
+    
 #if PIP_DEBUG
-    pip_debug_output_ip((struct ip*)buffer, "ip_input");
+    pip_debug_output_ip((struct ip*)*buffer, "ip_input");
 #endif
     
-    pip_ip_header * ip_header = new pip_ip_header(buffer);
-    
+    *ip_header = pip_ip_header(*buffer);
+    ip_header->checksum_valid = checksum_valid;
     
     if (ip_header->version == 6) {
         /// 暂不支持IPv6
-        delete ip_header;
-        return;
+        return false;
     }
     
     if (ip_header->version == 4) {
         /// - 检测是否有options 不支持options
         if (ip_header->has_options) {
-            delete ip_header;
-            return;
+            return false;
         }
     }
     
+    if (ip_header->datalen > length) {
+        this->_stats.bad_length += 1;
+        return false;
+    }
+    
+    return this->verify_input(*buffer, ip_header);
+}
+
+void pip_netif::dispatch_input(const void * buffer, pip_ip_header * ip_header) {
     pip_uint8 * data = ((pip_uint8 *)buffer) + ip_header->headerlen;
     switch (ip_header->protocol) {
         case IPPROTO_UDP:
@@ -76,41 +184,184 @@ void pip_netif::input(const void *buffer) {
             break;
             
         default:
-            delete ip_header;
             break;
     }
 }
 
 
+bool pip_netif::verify_input(const void * buffer, const pip_ip_header * ip_header) {
+    /// 长度检查与是否校验无关 之后的处理直接按头部中的长度读取数据
+    if (ip_header->headerlen < sizeof(struct ip) || ip_header->datalen < ip_header->headerlen) {
+        this->_stats.bad_length += 1;
+        return false;
+    }
+    
+    const pip_uint8 * data = (const pip_uint8 *)buffer + ip_header->headerlen;
+    pip_uint16 len = ip_header->datalen - ip_header->headerlen;
+    switch (ip_header->protocol) {
+        case IPPROTO_TCP: {
+            if (len < sizeof(struct tcphdr)) {
+                this->_stats.bad_length += 1;
+                return false;
+            }
+            
+            pip_uint16 th_len = ((const struct tcphdr *)data)->th_off * 4;
+            if (th_len < sizeof(struct tcphdr) || th_len > len) {
+                this->_stats.bad_length += 1;
+                return false;
+            }
+            break;
+        }
+            
+        case IPPROTO_UDP: {
+            if (len < sizeof(struct udphdr)) {
+                this->_stats.bad_length += 1;
+                return false;
+            }
+            
+            pip_uint16 uh_len = ntohs(((const struct udphdr *)data)->uh_ulen);
+            if (uh_len < sizeof(struct udphdr) || uh_len > len) {
+                this->_stats.bad_length += 1;
+                return false;
+            }
+            break;
+        }
+            
+        default:
+            break;
+    }
+    
+    if (!this->_verify_checksum) {
+        return true;
+    }
+    
+    if (pip_ip_checksum(buffer, ip_header->headerlen) != 0) {
+        this->_stats.ip_bad_checksum += 1;
+        return false;
+    }
+    
+    if (ip_header->checksum_valid) {
+        return true;
+    }
+    
+    switch (ip_header->protocol) {
+        case IPPROTO_TCP:
+            if (pip_inet_checksum(data, IPPROTO_TCP, ip_header->src, ip_header->dest, len) != 0) {
+                this->_stats.tcp_bad_checksum += 1;
+                return false;
+            }
+            break;
+            
+        case IPPROTO_UDP:
+            /// 校验和为0表示发送方没有计算
+            if (((const struct udphdr *)data)->uh_sum != 0 &&
+                pip_inet_checksum(data, IPPROTO_UDP, ip_header->src, ip_header->dest, len) != 0) {
+                this->_stats.udp_bad_checksum += 1;
+                return false;
+            }
+            break;
+            
+        default:
+            break;
+    }
+    
+    return true;
+}
+
 void pip_netif::output(pip_buf *buf, pip_uint8 proto, pip_uint32 src, pip_uint32 dest) {
+    pip_ip_template tmpl;
+    tmpl.init(proto, src, dest);
+    this->output(buf, &tmpl);
+}
+
+void pip_netif::output(pip_buf *buf, const pip_ip_template * tmpl) {
     
-    pip_buf * ip_head_buf = new pip_buf(sizeof(struct ip));
-    ip_head_buf->set_next(buf);
+    pip_buf * out_buf = buf;
+    bool merged = false;
+    if (this->_output_merge && buf->next != NULL && buf->total_len <= PIP_NETIF_OUTPUT_BUF && !this->_output_busy) {
+        /// 链表合并到输出缓冲 输出回调拿到连续的数据包 代价是每个包整包复制一次
+        /// 回调中嵌套输出时输出缓冲正在使用 不合并 直接输出链表
+        merged = true;
+        this->_output_busy = true;
+        if (this->_output_buf == NULL) {
+            this->_output_buf = new pip_buf(PIP_IP_HEADROOM, PIP_NETIF_OUTPUT_BUF);
+        }
+        
+        out_buf = this->_output_buf;
+        pip_uint8 * ptr = (pip_uint8 *)out_buf->payload;
+        for (pip_buf * q = buf; q != NULL; q = q->next) {
+            memcpy(ptr, q->payload, q->payload_len);
+            ptr += q->payload_len;
+        }
+        out_buf->payload_len = buf->total_len;
+        out_buf->total_len = buf->total_len;
+    }
+    
+    /// 预留空间足够时IP头部直接写在数据前面 否则单独分配放在链表头部
+    pip_buf * ip_head_buf = NULL;
+    if (out_buf->pre == NULL && out_buf->add_header(sizeof(struct ip))) {
+        ip_head_buf = out_buf;
+    } else {
+        ip_head_buf = new pip_buf(PIP_IP_HEADROOM - sizeof(struct ip), sizeof(struct ip));
+        ip_head_buf->set_next(out_buf);
+    }
+    
+    pip_uint16 ip_len = ip_head_buf->total_len;
+    pip_uint16 ip_id = this->_identifer++;
     
     struct ip *hdr = (struct ip *)ip_head_buf->payload;
-    hdr->ip_v = 4;
-    hdr->ip_hl = 5;
-    hdr->ip_tos = 0;
-    hdr->ip_len = htons(ip_head_buf->total_len);
-    hdr->ip_id = htons(this->_identifer++);
-    hdr->ip_off = htons(IP_DF);
-    hdr->ip_ttl = 64;
-    hdr->ip_p = proto;
-    hdr->ip_sum = 0;
-    hdr->ip_src.s_addr = htonl(src);
-    hdr->ip_dst.s_addr = htonl(dest);
-    hdr->ip_sum = htons(pip_ip_checksum(hdr, sizeof(struct ip)));
+    memcpy(hdr, &tmpl->hdr, sizeof(struct ip));
+    hdr->ip_len = htons(ip_len);
+    hdr->ip_id = htons(ip_id);
+    hdr->ip_sum = htons(pip_checksum_finish(tmpl->sum + ip_len + ip_id));
+    
+    /// 校验和卸载时在IP头部前面加上 virtio_net_hdr 空间不够时单独分配
+    pip_buf * vnet_buf = NULL;
+    if (this->_checksum_offload) {
+        if (ip_head_buf->add_header(sizeof(pip_vnet_hdr))) {
+            vnet_buf = ip_head_buf;
+        } else {
+            vnet_buf = new pip_buf(sizeof(pip_vnet_hdr));
+            vnet_buf->set_next(ip_head_buf);
+        }
+        
+        pip_vnet_hdr * vnet_hdr = (pip_vnet_hdr *)vnet_buf->payload;
+        memset(vnet_hdr, 0, sizeof(pip_vnet_hdr));
+        vnet_hdr->gso_type = PIP_VNET_HDR_GSO_NONE;
+        
+        if (tmpl->hdr.ip_p == IPPROTO_TCP || tmpl->hdr.ip_p == IPPROTO_UDP) {
+            vnet_hdr->flags = PIP_VNET_HDR_F_NEEDS_CSUM;
+            vnet_hdr->csum_start = sizeof(struct ip);
+            vnet_hdr->csum_offset = tmpl->hdr.ip_p == IPPROTO_TCP ? offsetof(struct tcphdr, th_sum) : offsetof(struct udphdr, uh_sum);
+            vnet_hdr->hdr_len = vnet_hdr->csum_start + vnet_hdr->csum_offset + sizeof(pip_uint16);
+        }
+    }
     
     if (this->output_ip_data_callback) {
-        this->output_ip_data_callback(this, ip_head_buf);
+        this->output_ip_data_callback(this, vnet_buf ? vnet_buf : ip_head_buf);
     }
     
 #if PIP_DEBUG
     pip_debug_output_ip(hdr, "ip_output");
 #endif
     
-    ip_head_buf->set_next(NULL);
-    delete ip_head_buf;
+    if (vnet_buf == ip_head_buf) {
+        ip_head_buf->remove_header(sizeof(pip_vnet_hdr));
+    } else if (vnet_buf != NULL) {
+        vnet_buf->set_next(NULL);
+        delete vnet_buf;
+    }
+    
+    if (ip_head_buf == out_buf) {
+        out_buf->remove_header(sizeof(struct ip));
+    } else {
+        ip_head_buf->set_next(NULL);
+        delete ip_head_buf;
+    }
+    
+    if (merged) {
+        this->_output_busy = false;
+    }
 }
 
 
@@ -121,9 +372,56 @@ void pip_netif::timer_tick() {
         this->_isn += 1;
     }
     
-    pip_tcp::timer_tick();
+    this->_timer_wheel.tick(get_current_time());
+}
+
+pip_uint64 pip_netif::next_timer_deadline() {
+    return this->_timer_wheel.next_deadline();
 }
 
 pip_uint32 pip_netif::get_isn() {
     return this->_isn;
 }
+
+pip_timer_wheel * pip_netif::get_timer_wheel() {
+    return &this->_timer_wheel;
+}
+
+void pip_netif::set_checksum_offload(bool enable) {
+    this->_checksum_offload = enable;
+}
+
+bool pip_netif::is_checksum_offload() {
+    return this->_checksum_offload;
+}
+
+void pip_netif::set_verify_checksum(bool enable) {
+    this->_verify_checksum = enable;
+}
+
+bool pip_netif::is_verify_checksum() {
+    return this->_verify_checksum;
+}
+
+void pip_netif::set_output_merge(bool enable) {
+    this->_output_merge = enable;
+}
+
+bool pip_netif::is_output_merge() {
+    return this->_output_merge;
+}
+
+pip_netif_stats pip_netif::get_stats() {
+    return this->_stats;
+}
+
+void pip_netif::reserve_pools(pip_uint32 packets, pip_uint32 connections) {
+    /// 每个数据包 TCP头部 发送缓冲环绕时的两段数据 以及输出时的IP头部 各一个 buf
+    pip_buf::get_pool()->reserve(packets * 4);
+    pip_tcp_packet::get_pool()->reserve(packets);
+    pip_tcp::get_pool()->reserve(connections);
+}
+
+bool pip_netif::reserve_arena(pip_uint64 size) {
+    return pip_arena::init(size);
+}
@@ -9,13 +9,17 @@
 
 #include "pip_type.hpp"
 #include "pip_buf.hpp"
+#include "pip_timer.hpp"
+#include "pip_ip_header.hpp"
 
 class pip_netif;
 class pip_tcp;
 
 /// 输出IP包数据
 /// @param netif _
-/// @param buf IP包数据
+/// @param buf IP包数据 一般是单个 buf 的连续内存 超过 PIP_NETIF_OUTPUT_BUF 时是链表 回调返回后失效
+/// 回调中可以再次输出 例如调用 write 嵌套输出的数据包不合并 可能是链表
+/// 关闭 set_output_merge 后链表原样输出 回调需要自己处理多段数据
 typedef void (*pip_netif_output_ip_data_callback) (pip_netif * netif, pip_buf * buf);
 
 /// 接受到一个新的TCP连接
@@ -36,10 +40,34 @@ typedef void (*pip_netif_new_tcp_connect_callback) (pip_netif * netif, pip_tcp *
 /// @param version IP协议版本 4 || 6
 typedef void (*pip_netif_received_udp_data_callback) (pip_netif * netif, void * buffer, pip_uint16 buffer_len, const char * src_ip, pip_uint16 src_port, const char * dest_ip, pip_uint16 dest_port, pip_uint8 version);
 
+/// 接受到UDP数据 二进制地址 不需要格式化字符串
+/// 设置后代替 pip_netif_received_udp_data_callback
+/// @param netif _
+/// @param buffer 数据
+/// @param buffer_len 数据长度
+/// @param src 来源地址
+/// @param dest 目的地址
+typedef void (*pip_netif_received_udp_packet_callback) (pip_netif * netif, void * buffer, pip_uint16 buffer_len, const pip_addr * src, const pip_addr * dest);
+
 // 接受到ICMP数据
 typedef void (*pip_netif_received_icmp_data_callback) (pip_netif * netif, void * buffer, pip_uint16 buffer_len, const char * src_ip, const char * dest_ip);
 
 
+/// 输入统计
+struct pip_netif_stats {
+    /// IP头部校验和错误丢弃的包
+    pip_uint64 ip_bad_checksum;
+    
+    /// TCP校验和错误丢弃的包
+    pip_uint64 tcp_bad_checksum;
+    
+    /// UDP校验和错误丢弃的包
+    pip_uint64 udp_bad_checksum;
+    
+    /// 长度不合法丢弃的包
+    pip_uint64 bad_length;
+};
+
 class pip_netif {
     pip_netif();
     ~pip_netif();
@@ -47,10 +75,19 @@ class pip_netif {
 public:
     static pip_netif * shared();
     
-    /// 输入IP包
+    /// 输入IP包 开启校验和卸载时 buffer 以 pip_vnet_hdr 开头
     /// @param buffer _
     void input(const void * buffer);
     
+    /// 批量输入IP包 一般是一次 recvmmsg 或一次读取环的结果
+    /// 先集中解析校验 再按连接分组处理 每个连接在一批内合并回复确认
+    /// 分组只让同一连接的包连续处理 每个包仍然单独经过一次 TCP 状态机 节省的是确认的数量
+    /// 不同连接之间的包可能不按输入顺序处理 同一连接内保持顺序
+    /// @param packets 每个包的起始地址 开启校验和卸载时以 pip_vnet_hdr 开头
+    /// @param lengths 每个包的长度 IP头部声明的长度超过时丢弃 TCP UDP 头部的长度不能超过IP头部声明的长度
+    /// @param count 包数量 超过 PIP_NETIF_BATCH_MAX 时分批处理
+    void input_batch(const void * const * packets, const pip_uint32 * lengths, int count);
+    
     /// 内部使用 外部通过 pip_netif_output_callback 获取输出的IP包
     /// @param buf _
     /// @param proto _
@@ -58,21 +95,97 @@ public:
     /// @param dest _
     void output(pip_buf * buf, pip_uint8 proto, pip_uint32 src, pip_uint32 dest);
     
+    /// 内部使用 按预先填充的头部输出 只填充长度 标识并补全校验和
+    /// @param buf _
+    /// @param tmpl _
+    void output(pip_buf * buf, const pip_ip_template * tmpl);
+    
     
-    /// 需要至少250ms调用一次该函数
+    /// 执行到期的定时器 可以按 next_timer_deadline 休眠后调用 也可以定期调用
     void timer_tick();
     
+    /// 最近一个定时器的到期时间 毫秒 get_current_time 时间基准 无定时器返回0
+    pip_uint64 next_timer_deadline();
+    
     pip_uint32 get_isn();
     
+    /// 协议栈共用的时间轮
+    pip_timer_wheel * get_timer_wheel();
+    
+    /// 校验和卸载 用于 IFF_VNET_HDR 打开的 Linux TUN
+    /// 开启后输入输出的IP包前都带 pip_vnet_hdr 输出的 TCP UDP 只填伪头部校验和 由内核补全
+    /// 输入带 PIP_VNET_HDR_F_DATA_VALID 的包不再校验
+    void set_checksum_offload(bool enable);
+    
+    bool is_checksum_offload();
+    
+    /// 是否校验输入包的校验和 错误的包直接丢弃并计数
+    /// 数据来源可以保证完整时可以关闭 校验和卸载时内核已经验证过的包总是跳过传输层校验
+    void set_verify_checksum(bool enable);
+    
+    bool is_verify_checksum();
+    
+    /// 是否把链表形式的输出包合并到连续内存再回调
+    /// TCP 数据段由头部和发送缓冲中的一到两段数据组成 合并时每个包多一次整包复制
+    /// 回调用 writev sendmsg 等按段输出时可以关闭 数据段不再复制
+    void set_output_merge(bool enable);
+    
+    bool is_output_merge();
+    
+    pip_netif_stats get_stats();
+    
+    /// 启动时预分配热路径对象池 避免运行中申请内存
+    /// @param packets 预计同时存在的数据包数量
+    /// @param connections 预计同时存在的连接数量
+    void reserve_pools(pip_uint32 packets, pip_uint32 connections = 0);
+    
+    /// 启用数据包内存区 只能启用一次 编译时 PIP_ARENA_SIZE 为0时默认不启用
+    /// 只有大页生效时才可能比 malloc 快 先在目标机器上运行 bench/bench_arena.cpp 确认
+    /// @param size 内存区大小 数据包缓冲和发送缓冲从这里分配
+    /// @return 已经启用或申请失败时返回 false 仍然从 malloc 分配
+    bool reserve_arena(pip_uint64 size);
+    
 public:
     pip_netif_output_ip_data_callback output_ip_data_callback;
     pip_netif_new_tcp_connect_callback new_tcp_connect_callback;
     pip_netif_received_udp_data_callback received_udp_data_callback;
+    pip_netif_received_udp_packet_callback received_udp_packet_callback;
     pip_netif_received_icmp_data_callback received_icmp_data_callback;
     
 private:
     pip_uint16 _identifer = 0;
     pip_uint32 _isn = 0;
+    pip_timer_wheel _timer_wheel;
+    
+    /// 合并链表输出使用的缓冲 预留了IP头部
+    pip_buf * _output_buf;
+    
+    /// 输出缓冲是否正在使用 输出回调中嵌套输出时不能覆盖
+    bool _output_busy;
+    
+    /// 是否开启校验和卸载
+    bool _checksum_offload;
+    
+    /// 是否校验输入包
+    bool _verify_checksum;
+    
+    /// 是否合并链表输出
+    bool _output_merge;
+    
+    pip_netif_stats _stats;
+    
+    /// 去掉 virtio_net_hdr 解析IP头部并校验 失败时计数
+    /// 通过后IP TCP UDP 头部中的长度都在 length 以内
+    /// @param buffer 输入包 返回时指向IP头部
+    /// @param length 输入包长度 未知时传 PIP_UINT32_MAX 只能依赖IP头部中的长度
+    /// @param ip_header 解析结果
+    bool parse_input(const void ** buffer, pip_uint32 length, pip_ip_header * ip_header);
+    
+    /// 按协议交给 TCP UDP 处理
+    void dispatch_input(const void * buffer, pip_ip_header * ip_header);
+    
+    /// 检查IP TCP UDP 头部中的长度 开启校验时再检查校验和 失败时计数
+    bool verify_input(const void * buffer, const pip_ip_header * ip_header);
 };
 
 
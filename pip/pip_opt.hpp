@@ -24,4 +24,95 @@
 #define PIP_TCP_WIND        65535
 #define PIP_TCP_MAX_CONNS   65535
 
+/// 窗口扩大因子上限 RFC 7323
+#define PIP_TCP_WSCALE_MAX  14
+
+/// 单个连接接收缓冲自动调整的上限
+#define PIP_TCP_RCV_BUF_MAX     (4 * 1024 * 1024)
+
+/// 所有连接接收缓冲总和上限 超过后不再扩大
+#define PIP_TCP_RCV_BUF_TOTAL   (64 * 1024 * 1024)
+
+/// 每个连接默认的发送缓冲上限
+#define PIP_TCP_SND_BUF     (256 * 1024)
+
+/// 发送缓冲第一次分配的容量 之后按需要翻倍 不超过连接的 snd_buf
+/// 数据全部确认后大于该容量或内存紧张时释放 空闲连接最多占用这么多
+#define PIP_TCP_SND_RING_MIN    (16 * 1024)
+
+/// 内存使用超过预算的 3/4 后 每个连接已发送未确认的数据不超过该值
+#define PIP_TCP_SND_BUF_SOFT    (32 * 1024)
+
+/// 单个连接乱序队列最多缓存的数据段数量 接收缓冲超过 64 个 MSS 时按接收缓冲放宽
+/// 缓存的字节不超过连接当前的接收缓冲
+#define PIP_TCP_REASS_MAX_SEGS      64
+
+/// 所有连接乱序队列最多缓存的字节
+#define PIP_TCP_REASS_MAX_TOTAL     (8 * 1024 * 1024)
+
+/// 乱序数据段从对象池分配时的最大数据长度 更长的数据段从 malloc 分配
+#define PIP_TCP_REASS_SEG_DATA      PIP_TCP_MSS
+
+/// 乱序数据段对象池每个 slab 的数量 乱序数据不常见 slab 比其他对象池小
+#define PIP_TCP_REASS_SLAB_SEGS     32
+
+/// 默认开启延迟确认
+#define PIP_TCP_DELAYED_ACK         1
+
+/// 延迟确认最长等待时间 毫秒
+#define PIP_TCP_DELAYED_ACK_TIME    40
+
+/// 初始重传超时 毫秒
+#define PIP_TCP_RTO_INIT    1000
+
+/// 重传超时上下限 毫秒
+#define PIP_TCP_RTO_MIN     200
+#define PIP_TCP_RTO_MAX     60000
+
+/// 最多重传次数 超过后重置连接
+#define PIP_TCP_MAX_RETRIES 8
+
+/// 收到多少个重复ACK触发快速重传
+#define PIP_TCP_DUP_ACK_THRESH  3
+
+/// 初始拥塞窗口 数据段数 RFC 6928
+#define PIP_TCP_INIT_CWND   10
+
+/// 主动关闭后等待对方确认的超时 毫秒
+#define PIP_TCP_FIN_TIMEOUT 20000
+
+/// 输出数据包在头部预留的空间 用于直接写入IP头部 以及校验和卸载时的 virtio_net_hdr
+#define PIP_IP_HEADROOM     32
+
+/// 输出数据包合并成连续内存的缓冲大小 超过时按链表输出
+#define PIP_NETIF_OUTPUT_BUF    2048
+
+/// 是否默认把链表形式的输出包合并到连续内存 可以通过 pip_netif::set_output_merge 修改
+/// TCP 数据段是头部加发送缓冲中的数据 合并时每个包整包复制一次
+#define PIP_NETIF_OUTPUT_MERGE  1
+
+/// 批量输入一次处理的最多包数 超过时分多批
+#define PIP_NETIF_BATCH_MAX     64
+
+/// 是否默认校验输入包的 IP TCP UDP 校验和 可以通过 pip_netif::set_verify_checksum 修改
+/// 默认不校验 与之前的行为一致 输入来自不可信的链路时建议开启 开销见 bench/bench_verify.cpp
+#define PIP_NETIF_VERIFY_CHECKSUM   0
+
+/// 协议栈全局内存预算 包括发送缓冲 乱序队列和连接对象
+#define PIP_MEM_BUDGET      (256ULL * 1024 * 1024)
+
+/// 对象池每次向系统申请的对象数量
+#define PIP_POOL_SLAB_OBJECTS   256
+
+/// 数据包内存区大小 创建协议栈时申请 0 表示不启用 数据包从 malloc 分配
+/// 运行时可以通过 pip_netif::reserve_arena 启用
+/// 没有大页时 bench/bench_arena.cpp 测得分配比 malloc 快 访问比 malloc 慢 所以默认不启用
+#define PIP_ARENA_SIZE      0
+
+/// 数据包内存区的最小块 一个 MSS 的数据包加上头部
+#define PIP_ARENA_SLOT      2048
+
+/// 缓存行大小 连接对象按该对齐 字段按访问频率分组 见 pip_tcp 的字段注释
+#define PIP_CACHE_LINE      64
+
 #endif /* pip_define_h */
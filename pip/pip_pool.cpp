@@ -0,0 +1,94 @@
+//
+//  pip_pool.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_pool.hpp"
+#include <string.h>
+#include <stdint.h>
+
+pip_pool::pip_pool(pip_uint32 object_size, pip_uint32 slab_objects, pip_uint32 align) {
+    this->_align = PIP_MAX(align, (pip_uint32)PIP_POOL_ALIGN);
+    object_size = PIP_MAX(object_size, (pip_uint32)sizeof(pip_pool_node));
+    this->_object_size = (object_size + this->_align - 1) & ~(this->_align - 1);
+    this->_slab_objects = PIP_MAX(slab_objects, (pip_uint32)1);
+    
+    this->_free_list = NULL;
+    this->_free_count = 0;
+    this->_slabs = NULL;
+    memset(&this->_stats, 0, sizeof(pip_pool_stats));
+}
+
+pip_pool::~pip_pool() {
+    while (this->_slabs) {
+        pip_pool_node * slab = this->_slabs;
+        this->_slabs = slab->next;
+        ::free(slab);
+    }
+}
+
+void * pip_pool::alloc() {
+    if (this->_free_list == NULL && !this->grow(this->_slab_objects)) {
+        return NULL;
+    }
+    
+    pip_pool_node * node = this->_free_list;
+    this->_free_list = node->next;
+    this->_free_count -= 1;
+    
+    this->_stats.allocs += 1;
+    this->_stats.in_use += 1;
+    return node;
+}
+
+void pip_pool::free(void * ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    
+    pip_pool_node * node = (pip_pool_node *)ptr;
+    node->next = this->_free_list;
+    this->_free_list = node;
+    this->_free_count += 1;
+    
+    this->_stats.frees += 1;
+    this->_stats.in_use -= 1;
+}
+
+bool pip_pool::reserve(pip_uint32 count) {
+    if (this->_free_count >= count) {
+        return true;
+    }
+    
+    return this->grow(count - this->_free_count);
+}
+
+pip_pool_stats pip_pool::get_stats() {
+    return this->_stats;
+}
+
+bool pip_pool::grow(pip_uint32 count) {
+    /// 头部保存 slab 链表 malloc 只保证 PIP_POOL_ALIGN 对齐 多申请一个对齐长度用于调整对象起始地址
+    size_t head = this->_align > PIP_POOL_ALIGN ? this->_align * 2 : PIP_POOL_ALIGN;
+    pip_uint8 * slab = (pip_uint8 *)malloc(head + (size_t)this->_object_size * count);
+    if (slab == NULL) {
+        return false;
+    }
+    
+    ((pip_pool_node *)slab)->next = this->_slabs;
+    this->_slabs = (pip_pool_node *)slab;
+    
+    /// 倒序挂到空闲链表 分配时按地址顺序取出
+    pip_uint8 * objects = (pip_uint8 *)(((uintptr_t)slab + PIP_POOL_ALIGN + this->_align - 1) & ~((uintptr_t)this->_align - 1));
+    for (pip_uint32 i = count; i > 0; i--) {
+        pip_pool_node * node = (pip_pool_node *)(objects + (size_t)this->_object_size * (i - 1));
+        node->next = this->_free_list;
+        this->_free_list = node;
+    }
+    
+    this->_free_count += count;
+    this->_stats.slab_allocs += 1;
+    this->_stats.capacity += count;
+    return true;
+}
@@ -0,0 +1,77 @@
+//
+//  pip_pool.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_pool_hpp
+#define pip_pool_hpp
+
+#include "pip_type.hpp"
+
+/// 对象默认对齐
+#define PIP_POOL_ALIGN  16
+
+/// 对象池统计
+struct pip_pool_stats {
+    /// 从池中分配的次数
+    pip_uint64 allocs;
+    
+    /// 归还的次数
+    pip_uint64 frees;
+    
+    /// 向系统申请 slab 的次数
+    pip_uint64 slab_allocs;
+    
+    /// 正在使用的对象数量
+    pip_uint32 in_use;
+    
+    /// 所有 slab 的对象总数
+    pip_uint32 capacity;
+};
+
+/// 固定大小对象池 内存按 slab 批量申请 释放的对象挂在空闲链表上复用 slab 不归还系统
+/// 只在协议栈线程使用 不加锁
+class pip_pool {
+    
+public:
+    /// @param object_size 对象大小
+    /// @param slab_objects 每个 slab 的对象数量
+    /// @param align 对象对齐 2的幂 不小于 PIP_POOL_ALIGN
+    pip_pool(pip_uint32 object_size, pip_uint32 slab_objects, pip_uint32 align = PIP_POOL_ALIGN);
+    ~pip_pool();
+    
+    /// 分配一个对象 空闲链表为空时申请新的 slab
+    void * alloc();
+    
+    /// 归还对象
+    void free(void * ptr);
+    
+    /// 预分配 保证至少有 count 个空闲对象
+    bool reserve(pip_uint32 count);
+    
+    pip_pool_stats get_stats();
+    
+private:
+    bool grow(pip_uint32 count);
+    
+private:
+    struct pip_pool_node {
+        pip_pool_node * next;
+    };
+    
+    pip_uint32 _object_size;
+    pip_uint32 _align;
+    pip_uint32 _slab_objects;
+    
+    /// 空闲对象链表
+    pip_pool_node * _free_list;
+    pip_uint32 _free_count;
+    
+    /// 已申请的 slab 链表 每个 slab 头部保存下一个 slab
+    pip_pool_node * _slabs;
+    
+    pip_pool_stats _stats;
+};
+
+#endif /* pip_pool_hpp */
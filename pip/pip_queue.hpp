@@ -9,81 +9,62 @@
 
 #include <stdio.h>
 
-template <class T>
-class pip_queue_node {
-    
-public:
-    T value;
-    pip_queue_node *next;
-};
-
+/// 队列 元素保存在容量为2的幂的环形数组中 满了按两倍扩容 稳定后 push pop 不再申请内存
 template <class T>
 class pip_queue {
     
 public:
     pip_queue() {
+        this->_items = NULL;
+        this->_mask = 0;
+        this->_head = 0;
         this->_size = 0;
-        this->_head = NULL;
-        this->_foot = NULL;
     };
     
     ~pip_queue() {
+        if (this->_items) {
+            delete [] this->_items;
+            this->_items = NULL;
+        }
     };
     
     
+    /// 队首元素 队列为空时返回 T 的默认值
     T front() {
         if (this->_size > 0) {
-            return this->_head->value;
+            return this->_items[this->_head];
         }
         
-        return NULL;
+        return T();
     };
     
     void push(T obj) {
-        pip_queue_node<T> * node = new pip_queue_node<T>;
-        node->value = obj;
-        node->next = NULL;
-        
-        if (this->_head == NULL) {
-            this->_head = node;
-        }
-        
-        if (this->_foot == NULL) {
-            this->_foot = node;
-        } else {
-            this->_foot->next = node;
-            this->_foot = node;
+        if (this->_size >= this->capacity()) {
+            this->grow();
         }
         
+        this->_items[(this->_head + this->_size) & this->_mask] = obj;
         this->_size += 1;
     };
     
     void pop() {
         if (this->_size > 0) {
-            pip_queue_node<T> * node = this->_head->next;
-            
-            if (this->_head == this->_foot) {
-                
-                delete this->_head;
-                this->_head = NULL;
-                this->_foot = NULL;
-                
-            } else {
-                
-                delete this->_head;
-                this->_head = NULL;
-            }
-            
-            this->_head = node;
+            this->_items[this->_head] = T();
+            this->_head = (this->_head + 1) & this->_mask;
             this->_size -= 1;
-
+            
             if (this->_size <= 0) {
-                this->_head = NULL;
-                this->_foot = NULL;
+                this->_head = 0;
             }
         }
     };
     
+    /// 按顺序访问 0 为队首
+    /// @param index 需要小于 size
+    T & at(int index) {
+        return this->_items[(this->_head + index) & this->_mask];
+    };
+    
     bool empty() {
         return this->size() <= 0;
     };
@@ -92,10 +73,34 @@ public:
         return this->_size;
     }
     
+    /// 当前容量
+    int capacity() {
+        return this->_items ? this->_mask + 1 : 0;
+    }
+    
+private:
+    void grow() {
+        int capacity = this->_items ? (this->_mask + 1) * 2 : 8;
+        T * items = new T[capacity];
+        
+        for (int i = 0; i < this->_size; i++) {
+            items[i] = this->_items[(this->_head + i) & this->_mask];
+        }
+        
+        if (this->_items) {
+            delete [] this->_items;
+        }
+        
+        this->_items = items;
+        this->_mask = capacity - 1;
+        this->_head = 0;
+    };
+    
 private:
+    T * _items;
+    int _mask;
+    int _head;
     int _size;
-    pip_queue_node<T> * _head;
-    pip_queue_node<T> * _foot;
 };
 
 #endif /* pip_queue_hpp */
@@ -0,0 +1,133 @@
+//
+//  pip_ring_buf.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_ring_buf.hpp"
+#include "pip_arena.hpp"
+#include <string.h>
+
+pip_ring_buf::pip_ring_buf() {
+    this->_buffer = NULL;
+    this->_mask = 0;
+    this->_head = 0;
+    this->_size = 0;
+}
+
+pip_ring_buf::~pip_ring_buf() {
+    this->clear();
+}
+
+bool pip_ring_buf::reserve(pip_uint32 capacity) {
+    if (this->_buffer != NULL) {
+        return true;
+    }
+
+    pip_uint32 cap = 1;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    this->_buffer = (pip_uint8 *)pip_arena::alloc(cap);
+    if (this->_buffer == NULL) {
+        return false;
+    }
+
+    this->_mask = cap - 1;
+    this->_head = 0;
+    this->_size = 0;
+    return true;
+}
+
+bool pip_ring_buf::resize(pip_uint32 capacity) {
+    pip_uint32 cap = 1;
+    while (cap < capacity || cap < this->_size) {
+        cap <<= 1;
+    }
+
+    pip_uint8 * buffer = (pip_uint8 *)pip_arena::alloc(cap);
+    if (buffer == NULL) {
+        return false;
+    }
+
+    /// 环绕的数据分两段复制
+    pip_uint32 copied = 0;
+    while (copied < this->_size) {
+        pip_uint32 slice_len = 0;
+        pip_uint8 * slice = this->slice(copied, this->_size - copied, &slice_len);
+        memcpy(buffer + copied, slice, slice_len);
+        copied += slice_len;
+    }
+
+    if (this->_buffer != NULL) {
+        pip_arena::free(this->_buffer);
+    }
+
+    this->_buffer = buffer;
+    this->_mask = cap - 1;
+    this->_head = 0;
+    return true;
+}
+
+pip_uint32 pip_ring_buf::write(const void * bytes, pip_uint32 len) {
+    len = PIP_MIN(len, this->space());
+
+    const pip_uint8 * src = (const pip_uint8 *)bytes;
+    pip_uint32 written = 0;
+    while (written < len) {
+        pip_uint32 pos = (this->_head + this->_size) & this->_mask;
+        pip_uint32 n = PIP_MIN(len - written, this->capacity() - pos);
+        memcpy(this->_buffer + pos, src + written, n);
+
+        written += n;
+        this->_size += n;
+    }
+
+    return written;
+}
+
+void pip_ring_buf::release(pip_uint32 len) {
+    len = PIP_MIN(len, this->_size);
+    this->_head = (this->_head + len) & this->_mask;
+    this->_size -= len;
+
+    if (this->_size <= 0) {
+        this->_head = 0;
+    }
+}
+
+pip_uint8 * pip_ring_buf::slice(pip_uint32 offset, pip_uint32 len, pip_uint32 * slice_len) {
+    if (offset >= this->_size) {
+        *slice_len = 0;
+        return NULL;
+    }
+
+    len = PIP_MIN(len, this->_size - offset);
+    pip_uint32 pos = (this->_head + offset) & this->_mask;
+    *slice_len = PIP_MIN(len, this->capacity() - pos);
+    return this->_buffer + pos;
+}
+
+void pip_ring_buf::clear() {
+    if (this->_buffer != NULL) {
+        pip_arena::free(this->_buffer);
+        this->_buffer = NULL;
+    }
+
+    this->_mask = 0;
+    this->_head = 0;
+    this->_size = 0;
+}
+
+pip_uint32 pip_ring_buf::size() {
+    return this->_size;
+}
+
+pip_uint32 pip_ring_buf::space() {
+    return this->capacity() - this->_size;
+}
+
+pip_uint32 pip_ring_buf::capacity() {
+    return this->_buffer ? this->_mask + 1 : 0;
+}
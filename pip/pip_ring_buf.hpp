@@ -0,0 +1,59 @@
+//
+//  pip_ring_buf.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_ring_buf_hpp
+#define pip_ring_buf_hpp
+
+#include "pip_type.hpp"
+
+/// 字节环形缓冲 容量为2的幂 数据从尾部写入 从头部按字节释放
+class pip_ring_buf {
+
+public:
+    pip_ring_buf();
+    ~pip_ring_buf();
+
+    /// 分配缓冲 容量向上取2的幂 已分配时不改变
+    /// @param capacity 最小容量
+    bool reserve(pip_uint32 capacity);
+
+    /// 重新分配缓冲 已有数据按顺序复制到新缓冲开头 相对头部的偏移不变
+    /// 之前 slice 返回的指针失效
+    /// @param capacity 最小容量 向上取2的幂 不能小于已有数据
+    bool resize(pip_uint32 capacity);
+
+    /// 写入数据 返回写入的长度 空间不足时只写入部分
+    pip_uint32 write(const void * bytes, pip_uint32 len);
+
+    /// 从头部释放数据
+    void release(pip_uint32 len);
+
+    /// 获取从 offset 开始的连续数据 环绕时只返回到缓冲末尾的部分
+    /// @param offset 相对头部的偏移
+    /// @param len 需要的长度
+    /// @param slice_len 输出 实际连续的长度
+    pip_uint8 * slice(pip_uint32 offset, pip_uint32 len, pip_uint32 * slice_len);
+
+    /// 释放缓冲内存
+    void clear();
+
+    /// 已写入未释放的数据长度
+    pip_uint32 size();
+
+    /// 剩余空间
+    pip_uint32 space();
+
+    /// 容量
+    pip_uint32 capacity();
+
+private:
+    pip_uint8 * _buffer;
+    pip_uint32 _mask;
+    pip_uint32 _head;
+    pip_uint32 _size;
+};
+
+#endif /* pip_ring_buf_hpp */
@@ -0,0 +1,202 @@
+//
+//  pip_timer.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_timer.hpp"
+
+// MARK: - pip_timer
+pip_timer::pip_timer() {
+    this->callback = NULL;
+    this->arg = NULL;
+    this->_expires = 0;
+    this->_next = NULL;
+    this->_pre = NULL;
+}
+
+pip_timer::~pip_timer() {
+    
+}
+
+bool pip_timer::is_scheduled() {
+    return this->_next != NULL;
+}
+
+pip_uint64 pip_timer::get_expires() {
+    return this->_expires;
+}
+
+// MARK: - pip_timer_wheel
+pip_timer_wheel::pip_timer_wheel() {
+    for (int level = 0; level < PIP_TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < PIP_TIMER_WHEEL_SIZE; i++) {
+            pip_timer * head = &this->_slots[level][i];
+            head->_next = head;
+            head->_pre = head;
+        }
+    }
+
+    this->_current = get_current_time() / PIP_TIMER_RESOLUTION;
+    this->_size = 0;
+}
+
+pip_timer_wheel::~pip_timer_wheel() {
+    for (int level = 0; level < PIP_TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < PIP_TIMER_WHEEL_SIZE; i++) {
+            pip_timer * head = &this->_slots[level][i];
+            while (head->_next != head) {
+                this->cancel(head->_next);
+            }
+
+            head->_next = NULL;
+            head->_pre = NULL;
+        }
+    }
+}
+
+void pip_timer_wheel::schedule(pip_timer * timer, pip_uint64 expires) {
+    this->cancel(timer);
+    timer->_expires = expires;
+    this->add(timer);
+    this->_size += 1;
+}
+
+void pip_timer_wheel::cancel(pip_timer * timer) {
+    if (timer->_next == NULL) {
+        return;
+    }
+
+    timer->_pre->_next = timer->_next;
+    timer->_next->_pre = timer->_pre;
+    timer->_next = NULL;
+    timer->_pre = NULL;
+    this->_size -= 1;
+}
+
+void pip_timer_wheel::add(pip_timer * timer) {
+    /// 向上取整 保证不会提前触发
+    pip_uint64 tick = (timer->_expires + PIP_TIMER_RESOLUTION - 1) / PIP_TIMER_RESOLUTION;
+    if (tick < this->_current) {
+        tick = this->_current;
+    }
+
+    pip_uint64 delta = tick - this->_current;
+    pip_uint64 max_delta = ((pip_uint64)1 << (PIP_TIMER_WHEEL_BITS * PIP_TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > max_delta) {
+        tick = this->_current + max_delta;
+        delta = max_delta;
+    }
+
+    int level = 0;
+    while (level < PIP_TIMER_WHEEL_LEVELS - 1 && delta >= ((pip_uint64)1 << (PIP_TIMER_WHEEL_BITS * (level + 1)))) {
+        level += 1;
+    }
+
+    int idx = (tick >> (PIP_TIMER_WHEEL_BITS * level)) & PIP_TIMER_WHEEL_MASK;
+    pip_timer * head = &this->_slots[level][idx];
+
+    timer->_next = head;
+    timer->_pre = head->_pre;
+    head->_pre->_next = timer;
+    head->_pre = timer;
+}
+
+void pip_timer_wheel::cascade(int level, int idx) {
+    pip_timer * head = &this->_slots[level][idx];
+    while (head->_next != head) {
+        pip_timer * timer = head->_next;
+
+        head->_next = timer->_next;
+        timer->_next->_pre = head;
+
+        this->add(timer);
+    }
+}
+
+void pip_timer_wheel::tick(pip_uint64 now) {
+    pip_uint64 target = now / PIP_TIMER_RESOLUTION;
+
+    while (this->_current <= target) {
+
+        if (this->_size <= 0) {
+            /// 没有定时器 直接跳到当前刻度
+            this->_current = target + 1;
+            break;
+        }
+
+        /// 取出到期槽 先推进刻度 回调中重新调度的定时器不会落回当前槽
+        pip_timer expired;
+        pip_timer * head = &this->_slots[0][this->_current & PIP_TIMER_WHEEL_MASK];
+        if (head->_next != head) {
+            expired._next = head->_next;
+            expired._pre = head->_pre;
+            expired._next->_pre = &expired;
+            expired._pre->_next = &expired;
+            head->_next = head;
+            head->_pre = head;
+        } else {
+            expired._next = &expired;
+            expired._pre = &expired;
+        }
+
+        this->_current += 1;
+
+        /// 低层转完一圈 把上一层对应槽的定时器下放
+        for (int level = 1; level < PIP_TIMER_WHEEL_LEVELS; level++) {
+            if (((this->_current >> (PIP_TIMER_WHEEL_BITS * (level - 1))) & PIP_TIMER_WHEEL_MASK) != 0) {
+                break;
+            }
+
+            this->cascade(level, (this->_current >> (PIP_TIMER_WHEEL_BITS * level)) & PIP_TIMER_WHEEL_MASK);
+        }
+
+        while (expired._next != &expired) {
+            pip_timer * timer = expired._next;
+            this->cancel(timer);
+
+            if (timer->callback) {
+                timer->callback(timer, timer->arg);
+            }
+        }
+
+        expired._next = NULL;
+        expired._pre = NULL;
+    }
+}
+
+pip_uint64 pip_timer_wheel::next_deadline() {
+    if (this->_size <= 0) {
+        return 0;
+    }
+
+    pip_uint64 deadline = 0;
+    for (int level = 0; level < PIP_TIMER_WHEEL_LEVELS; level++) {
+        /// 高层与当前刻度同索引的槽属于下一圈 放到最后检查
+        int start = (this->_current >> (PIP_TIMER_WHEEL_BITS * level)) & PIP_TIMER_WHEEL_MASK;
+        if (level > 0) {
+            start += 1;
+        }
+
+        for (int i = 0; i < PIP_TIMER_WHEEL_SIZE; i++) {
+            pip_timer * head = &this->_slots[level][(start + i) & PIP_TIMER_WHEEL_MASK];
+            if (head->_next == head) {
+                continue;
+            }
+
+            /// 同一层内槽按时间有序 第一个非空槽即为该层最早
+            for (pip_timer * timer = head->_next; timer != head; timer = timer->_next) {
+                if (deadline == 0 || timer->_expires < deadline) {
+                    deadline = timer->_expires;
+                }
+            }
+            break;
+        }
+    }
+
+    return deadline;
+}
+
+pip_uint32 pip_timer_wheel::size() {
+    return this->_size;
+}
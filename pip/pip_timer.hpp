@@ -0,0 +1,93 @@
+//
+//  pip_timer.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_timer_hpp
+#define pip_timer_hpp
+
+#include "pip_type.hpp"
+
+/// 时间轮精度 毫秒
+#define PIP_TIMER_RESOLUTION    10
+
+/// 每层槽数 2^6
+#define PIP_TIMER_WHEEL_BITS    6
+#define PIP_TIMER_WHEEL_SIZE    (1 << PIP_TIMER_WHEEL_BITS)
+#define PIP_TIMER_WHEEL_MASK    (PIP_TIMER_WHEEL_SIZE - 1)
+
+/// 层数 最大可表示 64^4 * 10ms 约 46 小时
+#define PIP_TIMER_WHEEL_LEVELS  4
+
+class pip_timer;
+
+/// 定时器到期回调 回调内可以重新调度或释放定时器所属对象
+typedef void (*pip_timer_callback) (pip_timer * timer, void * arg);
+
+/// 定时器 由所属对象持有 释放前需要从时间轮取消
+class pip_timer {
+    friend class pip_timer_wheel;
+
+public:
+    pip_timer();
+    ~pip_timer();
+
+    /// 是否已调度
+    bool is_scheduled();
+
+    /// 到期时间 毫秒
+    pip_uint64 get_expires();
+
+public:
+    pip_timer_callback callback;
+    void * arg;
+
+private:
+    pip_uint64 _expires;
+    pip_timer * _next;
+    pip_timer * _pre;
+};
+
+
+/// 分层时间轮 每个定时器挂在到期时间对应的槽上 tick 只处理到期的槽
+class pip_timer_wheel {
+
+public:
+    pip_timer_wheel();
+    ~pip_timer_wheel();
+
+    /// 调度定时器 已调度的会先取消
+    /// @param timer _
+    /// @param expires 到期时间 毫秒 get_current_time 时间基准
+    void schedule(pip_timer * timer, pip_uint64 expires);
+
+    /// 取消定时器
+    /// @param timer _
+    void cancel(pip_timer * timer);
+
+    /// 执行所有到期的定时器
+    /// @param now 当前时间 毫秒
+    void tick(pip_uint64 now);
+
+    /// 最近的到期时间 毫秒 没有定时器返回0
+    pip_uint64 next_deadline();
+
+    /// 已调度的定时器数量
+    pip_uint32 size();
+
+private:
+    void add(pip_timer * timer);
+    void cascade(int level, int idx);
+
+private:
+    /// 每个槽是一个带哨兵的双向循环链表
+    pip_timer _slots[PIP_TIMER_WHEEL_LEVELS][PIP_TIMER_WHEEL_SIZE];
+
+    /// 下一个要处理的刻度
+    pip_uint64 _current;
+
+    pip_uint32 _size;
+};
+
+#endif /* pip_timer_hpp */
@@ -33,6 +33,9 @@ typedef int32_t pip_int32;
 #define PIP_MAX(A, B) (A > B ? A : B)
 #define PIP_MIN(A, B) (A < B ? A : B)
 
+/// 只在调试输出中使用的参数
+#define PIP_UNUSED(X) (void)(X)
+
 typedef enum : pip_uint8 {
     pip_tcp_status_closed,
     /* received SYN wait response */
@@ -0,0 +1,39 @@
+//
+//  pip_vnet_hdr.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_vnet_hdr_hpp
+#define pip_vnet_hdr_hpp
+
+#include "pip_type.hpp"
+
+/// 数据包只有部分校验和 由接收方从 csum_start 开始计算 写到 csum_start + csum_offset
+#define PIP_VNET_HDR_F_NEEDS_CSUM   1
+
+/// 校验和已经验证过
+#define PIP_VNET_HDR_F_DATA_VALID   2
+
+/// 不分段
+#define PIP_VNET_HDR_GSO_NONE       0
+
+/// virtio_net_hdr 和 linux/virtio_net.h 布局一致 不依赖系统头文件
+/// IFF_VNET_HDR 打开的 TUN 每个包前面都带有该头部 字段为本机字节序
+struct pip_vnet_hdr {
+    pip_uint8 flags;
+    pip_uint8 gso_type;
+    
+    /// 以太网 IP 传输层头部总长度 不分段时只是提示
+    pip_uint16 hdr_len;
+    
+    pip_uint16 gso_size;
+    
+    /// 计算校验和的起始偏移 相对 IP 头部
+    pip_uint16 csum_start;
+    
+    /// 校验和字段相对 csum_start 的偏移
+    pip_uint16 csum_offset;
+};
+
+#endif /* pip_vnet_hdr_hpp */
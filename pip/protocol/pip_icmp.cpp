@@ -8,6 +8,7 @@
 #include "pip_icmp.hpp"
 #include "pip_netif.hpp"
 #include "pip_debug.hpp"
+#include <string.h>
 
 
 void pip_icmp::input(const void *bytes, struct ip *ip) {
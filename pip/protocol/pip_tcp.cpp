@@ -9,8 +9,10 @@
 #include "pip_checksum.hpp"
 #include "pip_netif.hpp"
 #include "pip_debug.hpp"
-#include <map>
+#include "pip_mem.hpp"
+#include "pip_flow_table.hpp"
 #include <unistd.h>
+#include <string.h>
 #include <arpa/inet.h>
 #include <mutex>
 
@@ -22,26 +24,40 @@ int is_before_seq(pip_uint32 seq, pip_uint32 ack) {
 
 pip_uint32 increase_seq(pip_uint32 seq, pip_uint8 flags, pip_uint32 datalen) {
     
-    if (datalen > 0) {
-        return seq + datalen;
-    }
+    seq += datalen;
     
+    /// SYN FIN 各占一个序号 FIN 可能和数据一起到达
     if (flags & TH_SYN || flags & TH_FIN) {
-        return seq + 1;
+        seq += 1;
     }
     return seq;
 }
 
 /// 当前连接
-static std::map<pip_uint32, pip_tcp *> tcp_connections;
+static pip_flow_table<pip_tcp *> tcp_connections;
 
-/// 根据标识提取连接
-/// @param iden 连接标识
-pip_tcp * fetch_tcp_connection(pip_uint32 iden) {
-    if (tcp_connections.find(iden) != tcp_connections.end()) {
-        return tcp_connections[iden];
-    }
-    return NULL;
+/// 根据四元组提取连接
+/// @param key 连接四元组
+pip_tcp * fetch_tcp_connection(const pip_flow_key & key) {
+    return tcp_connections.find(key);
+}
+
+/// 所有连接的统计合计
+static pip_tcp_stats tcp_global_stats = {};
+
+/// 所有连接的接收缓冲总和
+static pip_uint64 tcp_rcv_buf_total = 0;
+
+/// 是否处于批量输入
+static bool tcp_batching = false;
+
+/// 批量输入中挂起ACK的连接 每个连接最多一次 连接释放时置空
+static pip_tcp * tcp_batch_acks[PIP_NETIF_BATCH_MAX];
+static int tcp_batch_ack_count = 0;
+
+/// 协议栈时间轮
+pip_timer_wheel * tcp_timer_wheel() {
+    return pip_netif::shared()->get_timer_wheel();
 }
 
 pip_tcp::pip_tcp() {
@@ -51,24 +67,63 @@ pip_tcp::pip_tcp() {
     
     this->wind = PIP_TCP_WIND;
     this->mss = PIP_TCP_MSS;
+    this->wscale = 0;
     
     this->opp_wind = 0;
     this->opp_mss = 0;
+    this->opp_wscale = 0;
+    
+    this->_rcv_buf = PIP_TCP_WIND;
+    this->_adv_wind = 0;
+    this->_rcv_consumed = 0;
+    this->_rcv_measure_time = get_current_time();
+    tcp_rcv_buf_total += this->_rcv_buf;
     
     this->_last_ack = 0;
-    this->_is_wait_push_ack = false;
+    this->_lent_len = 0;
+    this->_mem_charged = false;
+    this->snd_buf = PIP_TCP_SND_BUF;
+    
+    this->_srtt = 0;
+    this->_rttvar = 0;
+    this->_rto = PIP_TCP_RTO_INIT;
+    
+    this->_dup_acks = 0;
+    this->_in_recovery = false;
+    this->_rto_recovery = false;
+    this->_recover = this->seq;
+    this->_cwnd = PIP_TCP_INIT_CWND * PIP_TCP_MSS;
+    this->_ssthresh = 0xFFFFFFFF;
     
     this->connected_callback = NULL;
     this->closed_callback = NULL;
     this->received_callback = NULL;
     this->written_callback = NULL;
     
-    this->ip_header = NULL;
+    this->src_ip = 0;
+    this->dest_ip = 0;
     
     this->arg = NULL;
     
-    this->_packet_queue = new pip_queue<pip_tcp_packet *>();
-    this->_fin_time = 0;
+    this->_retransmit_timer.callback = pip_tcp::retransmit_timer_callback;
+    this->_retransmit_timer.arg = this;
+    
+    this->_fin_timer.callback = pip_tcp::fin_timer_callback;
+    this->_fin_timer.arg = this;
+    
+    this->_ack_timer.callback = pip_tcp::ack_timer_callback;
+    this->_ack_timer.arg = this;
+    
+    this->_persist_timer.callback = pip_tcp::persist_timer_callback;
+    this->_persist_timer.arg = this;
+    this->_persist_backoff = 0;
+    
+    this->delayed_ack = PIP_TCP_DELAYED_ACK;
+    this->_ack_pending = 0;
+    this->_ack_now = false;
+    this->_ack_deferred = false;
+    this->_dup_acks_deferred = 0;
+    memset(&this->stats, 0, sizeof(pip_tcp_stats));
 }
 
 pip_tcp::~pip_tcp() {
@@ -76,6 +131,7 @@ pip_tcp::~pip_tcp() {
 }
 
 void pip_tcp::release(const char * debug_info) {
+    PIP_UNUSED(debug_info);
     if (this->status == pip_tcp_status_released) {
         return;
     }
@@ -89,22 +145,47 @@ void pip_tcp::release(const char * debug_info) {
     }
     printf("\n\n");
 #endif
-    tcp_connections.erase(this->_iden);
+    if (fetch_tcp_connection(this->_flow_key) == this) {
+        tcp_connections.remove(this->_flow_key);
+    }
     this->status = pip_tcp_status_released;
-    this->_fin_time = 0;
     
-    if (this->_packet_queue != NULL) {
-        
-        auto queue = this->_packet_queue;
-        this->_packet_queue = NULL;
-        
-        while (!queue->empty()) {
-            delete queue->front();
-            queue->pop();
+    tcp_timer_wheel()->cancel(&this->_retransmit_timer);
+    tcp_timer_wheel()->cancel(&this->_fin_timer);
+    tcp_timer_wheel()->cancel(&this->_ack_timer);
+    tcp_timer_wheel()->cancel(&this->_persist_timer);
+    
+    if (this->_ack_deferred) {
+        /// 批量输入中释放 不再发送挂起的ACK
+        for (int i = 0; i < tcp_batch_ack_count; i++) {
+            if (tcp_batch_acks[i] == this) {
+                tcp_batch_acks[i] = NULL;
+            }
         }
-        delete queue;
+        this->_ack_deferred = false;
     }
     
+    this->_reass.clear();
+    
+    if (this->_mem_charged) {
+        pip_mem::uncharge(pip_mem_type_tcp_conn, sizeof(pip_tcp));
+        this->_mem_charged = false;
+    }
+    
+    tcp_rcv_buf_total -= this->_rcv_buf;
+    this->_rcv_buf = 0;
+    
+    while (!this->_packet_queue.empty()) {
+        delete this->_packet_queue.front();
+        this->_packet_queue.pop();
+    }
+    
+    pip_mem::uncharge(pip_mem_type_tcp_snd, this->_snd_ring.capacity());
+    this->_snd_ring.clear();
+    
+    /// 数据包已经释放 借出缓冲全部归还
+    this->release_lent(true);
+    
     if (this->connected_callback != NULL) {
         this->connected_callback = NULL;
     }
@@ -117,11 +198,6 @@ void pip_tcp::release(const char * debug_info) {
         this->written_callback = NULL;
     }
     
-    if (this->ip_header != NULL) {
-        free(this->ip_header);
-        this->ip_header = NULL;
-    }
-    
     void * arg = this->arg;
     this->arg = NULL;
     
@@ -133,66 +209,205 @@ void pip_tcp::release(const char * debug_info) {
     
 }
 
-void pip_tcp::timer_tick() {
-    
-    pip_uint64 cur_time = get_current_time();
-    if (tcp_connections.size() <= 0) {
+// MARK: - Timer
+void pip_tcp::retransmit_timer_callback(pip_timer *, void * arg) {
+    pip_tcp * tcp = (pip_tcp *)arg;
+    if (tcp->_packet_queue.empty()) {
         return;
     }
     
-    std::map<pip_uint32, pip_tcp *>::iterator iter;
-    for (iter = tcp_connections.begin(); iter != tcp_connections.end();) {
+    pip_tcp_packet * packet = tcp->_packet_queue.front();
+    if (get_current_time() - packet->get_send_time() >= tcp->_rto) {
+        /// 超时未确认
 
-        pip_tcp * tcp = iter->second;
-        iter ++;
+        if (packet->get_send_count() > PIP_TCP_MAX_RETRIES) {
+            /// 重传次数用完 对方不可达 重置连接
+            tcp->reset();
+            return;
+        }
         
-        if ((tcp->status == pip_tcp_status_fin_wait_1 || tcp->status == pip_tcp_status_fin_wait_2) &&
-            cur_time - tcp->_fin_time >= 20000) {
-            /// 处于等待关闭状态 并且等待时间已经大于20秒 直接关闭
-            
-            tcp->release("timer_tick");
-            delete tcp;
-            
-        } else {
+        /// 指数退避后重发 超时后不再沿用之前的快速恢复
+        tcp->_rto = PIP_MIN(tcp->_rto * 2, PIP_TCP_RTO_MAX);
+        tcp->_dup_acks = 0;
+        tcp->_in_recovery = false;
+        
+        /// RFC 5681 拥塞窗口降为一个数据段 连续超时不再降低阈值
+        if (!tcp->_rto_recovery) {
+            tcp->reduce_ssthresh();
+        }
+        tcp->_cwnd = tcp->opp_mss;
+        
+        /// 超时前发出的数据 之后每个部分确认重传下一个缺口 不再逐个等待超时
+        tcp->_rto_recovery = true;
+        tcp->_recover = tcp->seq;
+        
+        tcp->stats.timeout_retransmits += 1;
+        tcp_global_stats.timeout_retransmits += 1;
+        tcp->resend_packet(packet);
+    }
+    
+    tcp->restart_retransmit_timer();
+}
 
-            pip_tcp_packet * packet = tcp->_packet_queue->front();
+void pip_tcp::ack_timer_callback(pip_timer *, void * arg) {
+    pip_tcp * tcp = (pip_tcp *)arg;
+    if (tcp->_ack_pending > 0) {
+        tcp->send_ack();
+    }
+}
 
-            if (packet) {
-                if (cur_time - packet->get_send_time() >= 2000) {
-                    /// 数据超过2秒没有确认
+void pip_tcp::persist_timer_callback(pip_timer *, void * arg) {
+    pip_tcp * tcp = (pip_tcp *)arg;
+    if (tcp->opp_wind > 0 || !tcp->_packet_queue.empty()) {
+        return;
+    }
+    
+    tcp->send_window_probe();
+    
+    if (tcp->_persist_backoff < 16) {
+        tcp->_persist_backoff += 1;
+    }
+    tcp->update_persist_timer();
+}
 
-                    if (packet->get_send_count() > 2) {
-                        /// 已经发送过2次的直接丢弃
-                        tcp->_packet_queue->pop();
+void pip_tcp::fin_timer_callback(pip_timer *, void * arg) {
+    /// 处于等待关闭状态 并且等待时间已经大于20秒 直接关闭
+    pip_tcp * tcp = (pip_tcp *)arg;
+    tcp->release("fin_timer");
+    delete tcp;
+}
 
-                        if (packet->get_hdr()->th_flags & TH_PUSH) {
-                            tcp->_is_wait_push_ack = false;
-                        }
+void pip_tcp::restart_retransmit_timer() {
+    if (this->_packet_queue.empty()) {
+        tcp_timer_wheel()->cancel(&this->_retransmit_timer);
+        return;
+    }
+    
+    pip_tcp_packet * packet = this->_packet_queue.front();
+    tcp_timer_wheel()->schedule(&this->_retransmit_timer, packet->get_send_time() + this->_rto);
+}
 
-                        if (tcp->written_callback) {
-                            tcp->written_callback(tcp, packet->get_payload_len());
-                        }
+void pip_tcp::update_rtt(pip_uint32 rtt) {
+    if (this->_srtt == 0) {
+        /// 第一个样本
+        this->_srtt = rtt;
+        this->_rttvar = rtt / 2;
+    } else {
+        pip_uint32 delta = this->_srtt > rtt ? this->_srtt - rtt : rtt - this->_srtt;
+        this->_rttvar = (this->_rttvar * 3 + delta) / 4;
+        this->_srtt = (this->_srtt * 7 + rtt) / 8;
+    }
+    
+    /// RFC 6298 RTO = SRTT + max(G, 4 * RTTVAR)
+    pip_uint32 rto = this->_srtt + PIP_MAX(PIP_TIMER_RESOLUTION, this->_rttvar * 4);
+    rto = PIP_MAX(rto, PIP_TCP_RTO_MIN);
+    rto = PIP_MIN(rto, PIP_TCP_RTO_MAX);
+    this->_rto = rto;
+}
 
-                        delete packet;
+pip_uint32 pip_tcp::flight_size() {
+    /// 发送缓冲和借出缓冲中的数据就是已发送未确认的数据
+    return this->_snd_ring.size() + this->_lent_len;
+}
 
+void pip_tcp::reduce_ssthresh() {
+    /// RFC 5681 式4 ssthresh = max(FlightSize / 2, 2 * SMSS)
+    this->_ssthresh = PIP_MAX(this->flight_size() / 2, 2 * (pip_uint32)this->opp_mss);
+}
 
-                    } else {
-                        /// 小于2次的重发
-                        tcp->resend_packet(packet);
-                    }
+void pip_tcp::grow_cwnd(pip_uint32 acked) {
+    if (acked == 0) {
+        return;
+    }
+    
+    if (this->_cwnd < this->_ssthresh) {
+        /// 慢启动 每个确认最多增加一个数据段
+        this->_cwnd += PIP_MIN(acked, (pip_uint32)this->opp_mss);
+    } else {
+        /// 拥塞避免 每个RTT约增加一个数据段
+        this->_cwnd += PIP_MAX((pip_uint32)1, (pip_uint32)this->opp_mss * this->opp_mss / this->_cwnd);
+    }
+    
+    /// 超过发送缓冲的部分用不上 长时间没有丢包也不会溢出
+    this->_cwnd = PIP_MIN(this->_cwnd, PIP_MAX(this->snd_buf, (pip_uint32)this->opp_mss));
+}
 
-                }
+void pip_tcp::start_fin_timer() {
+    tcp_timer_wheel()->schedule(&this->_fin_timer, get_current_time() + PIP_TCP_FIN_TIMEOUT);
+}
 
-            }
-        }
+void pip_tcp::update_persist_timer() {
+    if (this->opp_wind > 0 || this->status != pip_tcp_status_established || !this->_packet_queue.empty()) {
+        /// 窗口已打开 或者有未确认的数据 由重传定时器探测
+        tcp_timer_wheel()->cancel(&this->_persist_timer);
+        this->_persist_backoff = 0;
+        return;
+    }
+    
+    if (!this->_persist_timer.is_scheduled()) {
+        pip_uint64 timeout = PIP_MIN((pip_uint64)this->_rto << this->_persist_backoff, (pip_uint64)PIP_TCP_RTO_MAX);
+        tcp_timer_wheel()->schedule(&this->_persist_timer, get_current_time() + timeout);
     }
 }
 
+void pip_tcp::init_header_template() {
+    /// 发出的数据包 源地址是本端 目标地址是对方
+    this->_header_template.ip.init(IPPROTO_TCP, this->dest_ip, this->src_ip);
+    this->_header_template.sport = htons(this->dest_port);
+    this->_header_template.dport = htons(this->src_port);
+    
+    pip_uint32 sum = pip_inet_pseudo_sum(IPPROTO_TCP, this->dest_ip, this->src_ip);
+    sum += this->dest_port;
+    sum += this->src_port;
+    this->_header_template.sum = sum;
+}
+
+pip_uint16 pip_tcp::header_wind(pip_uint8 flags) {
+    pip_uint32 value = (flags & TH_SYN) ? this->wind : this->wind >> this->wscale;
+    return PIP_MIN(value, 0xFFFF);
+}
+
 // MARK: - -
 pip_uint32 pip_tcp::current_connections() {
     return (pip_uint32)tcp_connections.size();
 }
 
+pip_uint32 pip_tcp::current_reass_bytes() {
+    return pip_tcp_reass::total_bytes();
+}
+
+pip_uint64 pip_tcp::current_rcv_buf_bytes() {
+    return tcp_rcv_buf_total;
+}
+
+pip_tcp_stats pip_tcp::global_stats() {
+    return tcp_global_stats;
+}
+
+void * pip_tcp::operator new(size_t) {
+    void * ptr = get_pool()->alloc();
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void pip_tcp::operator delete(void * ptr) {
+    get_pool()->free(ptr);
+}
+
+pip_pool * pip_tcp::get_lent_pool() {
+    /// 不释放 保证晚于所有借出缓冲归还
+    static pip_pool * pool = new pip_pool(sizeof(pip_tcp_lent), PIP_POOL_SLAB_OBJECTS);
+    return pool;
+}
+
+pip_pool * pip_tcp::get_pool() {
+    /// 不释放 保证晚于所有连接销毁
+    static pip_pool * pool = new pip_pool(sizeof(pip_tcp), PIP_POOL_SLAB_OBJECTS, PIP_CACHE_LINE);
+    return pool;
+}
+
 void pip_tcp::connected(const void *bytes) {
     if (this->status != pip_tcp_status_wait_establishing) {
         return;
@@ -230,10 +445,10 @@ void pip_tcp::close() {
             
         case pip_tcp_status_established: {
             this->status = pip_tcp_status_fin_wait_1;
-            this->_fin_time = get_current_time();
+            this->start_fin_timer();
 
             pip_tcp_packet *packet = new pip_tcp_packet(this, TH_FIN | TH_ACK, NULL, NULL, "pip_tcp::close");
-            this->_packet_queue->push(packet);
+            this->_packet_queue.push(packet);
             this->send_packet(packet);
             break;
         }
@@ -268,71 +483,472 @@ void pip_tcp::reset() {
 }
 
 pip_uint32 pip_tcp::write(const void *bytes, pip_uint32 len) {
+    struct iovec iov;
+    iov.iov_base = (void *)bytes;
+    iov.iov_len = len;
+    return this->writev(&iov, 1);
+}
+
+pip_uint32 pip_tcp::writev(const struct iovec * iov, int iovcnt) {
     if (this->status != pip_tcp_status_established || !this->can_write()) {
         return 0;
     }
     
-    pip_uint32 offset = 0;
-    while (offset < len && this->opp_wind > 0) {
+    return this->write_ring(iov, iovcnt, true);
+}
+
+pip_uint32 pip_tcp::writev_lent(const struct iovec * iov, int iovcnt, pip_tcp_lent_callback callback, void * arg) {
+    if (this->status != pip_tcp_status_established || !this->can_write()) {
+        return 0;
+    }
+    
+    /// 先全部借出 再整体按 MSS 分段 小缓冲合并到同一个数据段
+    pip_tcp_lent * first = NULL;
+    pip_uint32 len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        pip_uint32 window = this->send_window();
+        if (window <= 0) {
+            break;
+        }
         
-        pip_uint16 write_len = this->opp_mss;
+        pip_uint32 iov_len = (pip_uint32)PIP_MIN(iov[i].iov_len, (size_t)window);
+        if (iov_len <= 0) {
+            continue;
+        }
         
-        /// 获取小于等于mss的数据长度
-        if (offset + write_len > len) {
-            write_len = len - offset;
+        pip_tcp_lent * lent = this->add_lent(iov[i].iov_base, iov_len, NULL, callback, arg);
+        if (lent == NULL) {
+            break;
         }
         
-        /// 获取小于等于对方的窗口长度
-        if (write_len > this->opp_wind) {
-            write_len = this->opp_wind;
+        if (first == NULL) {
+            first = lent;
+        }
+        len += iov_len;
+        
+        if (iov_len < iov[i].iov_len) {
+            break;
+        }
+    }
+    
+    if (first) {
+        this->send_segments(first, 0, len, true);
+    }
+    return len;
+}
+
+pip_uint32 pip_tcp::write_buf(pip_buf * buf) {
+    if (this->status != pip_tcp_status_established || !this->can_write()) {
+        return 0;
+    }
+    
+    /// 连续引用数据块的 buf 借出后一起分段 连续的其他 buf 一起复制到发送缓冲后分段
+    /// 只有两类 buf 交替的地方会产生不满 MSS 的数据段
+    pip_uint32 len = 0;
+    pip_buf * q = buf;
+    bool full = false;
+    while (q != NULL && !full) {
+        bool is_block = q->block != NULL;
+        pip_tcp_lent * first = NULL;
+        pip_uint32 ring_offset = this->_snd_ring.size();
+        pip_uint32 run_len = 0;
+        
+        for (; q != NULL && (q->block != NULL) == is_block; q = q->next) {
+            pip_uint32 window = this->send_window();
+            pip_uint32 q_len = PIP_MIN((pip_uint32)q->payload_len, window);
+            if (q_len <= 0 && q->payload_len > 0) {
+                full = true;
+                break;
+            }
+            
+            if (q_len <= 0) {
+                continue;
+            }
+            
+            if (is_block) {
+                /// 引用数据块 确认后释放引用
+                pip_tcp_lent * lent = this->add_lent(q->payload, q_len, q->block, NULL, NULL);
+                if (lent == NULL) {
+                    full = true;
+                    break;
+                }
+                
+                if (first == NULL) {
+                    first = lent;
+                }
+                
+            } else {
+                /// 没有数据块的部分复制到发送缓冲
+                struct iovec iov;
+                iov.iov_base = q->payload;
+                iov.iov_len = q_len;
+                q_len = this->copy_ring(&iov, 1);
+            }
+            
+            run_len += q_len;
+            if (q_len < (pip_uint32)q->payload_len) {
+                full = true;
+                break;
+            }
+        }
+        
+        if (run_len > 0) {
+            this->send_segments(first, is_block ? 0 : ring_offset, run_len, q == NULL || full);
+        }
+        len += run_len;
+    }
+    
+    return len;
+}
+
+pip_uint32 pip_tcp::snd_ring_size() {
+    pip_uint32 size = this->snd_buf;
+    if (pip_mem::is_pressured()) {
+        size = PIP_MIN(size, (pip_uint32)PIP_TCP_SND_BUF_SOFT);
+    }
+    return size;
+}
+
+pip_uint32 pip_tcp::write_ring(const struct iovec * iov, int iovcnt, bool push) {
+    /// 数据只复制一次到发送缓冲 数据包直接引用缓冲中的数据
+    pip_uint32 ring_offset = this->_snd_ring.size();
+    pip_uint32 len = this->copy_ring(iov, iovcnt);
+    
+    this->send_segments(NULL, ring_offset, len, push);
+    return len;
+}
+
+pip_uint32 pip_tcp::copy_ring(const struct iovec * iov, int iovcnt) {
+    pip_uint32 window = this->send_window();
+    pip_uint32 total = 0;
+    for (int i = 0; i < iovcnt && total < window; i++) {
+        total += (pip_uint32)PIP_MIN(iov[i].iov_len, (size_t)(window - total));
+    }
+    
+    /// 不能扩大时写满现有的空间
+    this->grow_ring(this->_snd_ring.size() + total);
+    
+    pip_uint32 len = 0;
+    for (int i = 0; i < iovcnt && len < window; i++) {
+        pip_uint32 iov_len = (pip_uint32)PIP_MIN(iov[i].iov_len, (size_t)(window - len));
+        pip_uint32 n = this->_snd_ring.write(iov[i].iov_base, iov_len);
+        len += n;
+        
+        if (n < iov_len) {
+            break;
+        }
+    }
+    
+    return len;
+}
+
+bool pip_tcp::grow_ring(pip_uint32 size) {
+    pip_uint32 old_capacity = this->_snd_ring.capacity();
+    if (size <= old_capacity) {
+        return true;
+    }
+    
+    pip_uint32 capacity = PIP_MAX(old_capacity, (pip_uint32)PIP_TCP_SND_RING_MIN);
+    pip_uint32 limit = PIP_MAX(this->snd_ring_size(), (pip_uint32)PIP_TCP_SND_RING_MIN);
+    while (capacity < size && capacity < limit) {
+        capacity <<= 1;
+    }
+    
+    if (capacity <= old_capacity) {
+        return false;
+    }
+    
+    /// 按增加的容量记账
+    if (!pip_mem::charge(pip_mem_type_tcp_snd, capacity - old_capacity)) {
+        return false;
+    }
+    
+    if (!this->_snd_ring.resize(capacity)) {
+        pip_mem::uncharge(pip_mem_type_tcp_snd, capacity - old_capacity);
+        return false;
+    }
+    
+    /// 数据包引用旧缓冲 按在发送缓冲中的顺序改为引用新缓冲 相对头部的偏移不变
+    pip_uint32 offset = 0;
+    for (int i = 0; i < this->_packet_queue.size(); i++) {
+        pip_tcp_packet * pkt = this->_packet_queue.at(i);
+        pip_uint32 len = pkt->get_payload_len();
+        if (pkt->get_lent() != NULL || len <= 0) {
+            continue;
+        }
+        
+        pkt->trim(this, 0, this->ring_payload(offset, len));
+        offset += len;
+    }
+    return true;
+}
+
+void pip_tcp::shrink_ring() {
+    if (this->_snd_ring.capacity() <= 0 || this->_snd_ring.size() > 0) {
+        return;
+    }
+    
+    /// 小缓冲保留 避免每次写入都重新分配
+    if (this->_snd_ring.capacity() <= PIP_TCP_SND_RING_MIN && !pip_mem::is_pressured()) {
+        return;
+    }
+    
+    pip_mem::uncharge(pip_mem_type_tcp_snd, this->_snd_ring.capacity());
+    this->_snd_ring.clear();
+}
+
+pip_tcp_lent * pip_tcp::add_lent(const void * bytes, pip_uint32 len, pip_buf_block * block, pip_tcp_lent_callback callback, void * arg) {
+    if (!pip_mem::charge(pip_mem_type_tcp_snd, len)) {
+        return NULL;
+    }
+    
+    pip_tcp_lent * lent = (pip_tcp_lent *)get_lent_pool()->alloc();
+    if (lent == NULL) {
+        pip_mem::uncharge(pip_mem_type_tcp_snd, len);
+        return NULL;
+    }
+    
+    lent->bytes = bytes;
+    lent->len = len;
+    lent->acked = 0;
+    lent->block = block;
+    lent->callback = callback;
+    lent->arg = arg;
+    lent->next = NULL;
+    
+    if (!this->_lent_queue.empty()) {
+        this->_lent_queue.at(this->_lent_queue.size() - 1)->next = lent;
+    }
+    
+    if (block) {
+        block->retain();
+    }
+    
+    this->_lent_queue.push(lent);
+    this->_lent_len += len;
+    return lent;
+}
+
+void pip_tcp::send_segments(pip_tcp_lent * lent, pip_uint32 offset, pip_uint32 len, bool push) {
+    pip_uint32 sent = 0;
+    while (sent < len) {
+        
+        pip_uint32 write_len = this->opp_mss;
+        
+        /// 获取小于等于mss的数据长度
+        if (sent + write_len > len) {
+            write_len = len - sent;
         }
         
         if (write_len <= 0) {
             break;
         }
         
-        /// 如果当前发送数据大于等于总数据长度 或者 对方窗口为0 则发送PUSH标签
-        pip_uint8 is_push = offset + write_len >= len || write_len >= this->opp_wind;
+        /// 如果当前发送数据大于等于总数据长度 则发送PUSH标签
+        pip_uint8 is_push = push && sent + write_len >= len;
         
-        pip_buf * payload_buf = new pip_buf((pip_uint8 *)bytes + offset, write_len, 1);
+        pip_buf * payload_buf = this->payload_buf(lent, offset + sent, write_len);
         pip_tcp_packet * packet;
         if (is_push) {
             packet = new pip_tcp_packet(this, TH_PUSH | TH_ACK, NULL, payload_buf, "pip_tcp::write1");
-            this->_is_wait_push_ack = true;
-            
         } else {
             packet = new pip_tcp_packet(this, TH_ACK, NULL, payload_buf, "pip_tcp::write2");
         }
+        pip_tcp_lent * packet_lent = lent;
+        pip_uint32 packet_offset = offset + sent;
+        if (packet_lent) {
+            seek_lent(&packet_lent, &packet_offset);
+        }
+        packet->set_lent(packet_lent, packet_offset);
         
-        this->_packet_queue->push(packet);
+        this->_packet_queue.push(packet);
         this->send_packet(packet);
         
-        offset += write_len;
-        this->opp_wind -= write_len;
+        sent += write_len;
+    }
+}
+
+pip_buf * pip_tcp::payload_buf(pip_tcp_lent * lent, pip_uint32 offset, pip_uint32 len) {
+    if (lent == NULL) {
+        return this->ring_payload(offset, len);
+    }
+    
+    /// 数据段跨越多个借出缓冲时 每个缓冲一段 buf
+    pip_buf * head = NULL;
+    pip_buf * tail = NULL;
+    while (len > 0) {
+        seek_lent(&lent, &offset);
+        pip_uint32 piece_len = PIP_MIN(len, lent->len - offset);
+        
+        pip_buf * buf;
+        if (lent->block) {
+            /// 数据包持有数据块的引用 重传和调用方共享同一份数据
+            int block_offset = (int)((const pip_uint8 *)lent->bytes - lent->block->data()) + offset;
+            buf = new pip_buf(lent->block, block_offset, piece_len);
+        } else {
+            buf = new pip_buf((pip_uint8 *)lent->bytes + offset, piece_len, 0);
+        }
+        
+        if (head == NULL) {
+            head = buf;
+        } else {
+            tail->set_next(buf);
+        }
+        tail = buf;
+        
+        offset += piece_len;
+        len -= piece_len;
+    }
+    
+    return head;
+}
+
+void pip_tcp::seek_lent(pip_tcp_lent ** lent, pip_uint32 * offset) {
+    while (*offset >= (*lent)->len && (*lent)->next != NULL) {
+        *offset -= (*lent)->len;
+        *lent = (*lent)->next;
+    }
+}
+
+void pip_tcp::release_acked(pip_tcp_packet * packet, pip_uint32 len) {
+    pip_tcp_lent * lent = packet->get_lent();
+    if (lent == NULL) {
+        this->_snd_ring.release(len);
+        return;
+    }
+    
+    /// 已确认的部分可能跨越多个借出缓冲
+    pip_uint32 offset = packet->get_lent_offset();
+    this->_lent_len -= len;
+    while (len > 0) {
+        seek_lent(&lent, &offset);
+        pip_uint32 acked = PIP_MIN(len, lent->len - offset);
+        lent->acked += acked;
+        offset += acked;
+        len -= acked;
+    }
+}
+
+void pip_tcp::release_lent(bool all) {
+    while (!this->_lent_queue.empty()) {
+        pip_tcp_lent * lent = this->_lent_queue.front();
+        if (!all && lent->acked < lent->len) {
+            break;
+        }
+        
+        this->_lent_queue.pop();
+        if (all) {
+            this->_lent_len -= lent->len - lent->acked;
+        }
+        
+        if (lent->callback) {
+            lent->callback(this, lent->bytes, lent->len, lent->arg);
+        }
+        
+        if (lent->block) {
+            lent->block->release();
+        }
+        pip_mem::uncharge(pip_mem_type_tcp_snd, lent->len);
+        get_lent_pool()->free(lent);
+    }
+}
+
+pip_buf * pip_tcp::ring_payload(pip_uint32 offset, pip_uint32 len) {
+    pip_buf * head = NULL;
+    pip_buf * tail = NULL;
+    
+    /// 数据在缓冲末尾环绕时分成两段
+    while (len > 0) {
+        pip_uint32 slice_len = 0;
+        pip_uint8 * slice = this->_snd_ring.slice(offset, len, &slice_len);
+        if (slice == NULL || slice_len <= 0) {
+            break;
+        }
+        
+        pip_buf * buf = new pip_buf(slice, slice_len, 0);
+        if (head == NULL) {
+            head = buf;
+        } else {
+            tail->set_next(buf);
+        }
+        tail = buf;
+        
+        offset += slice_len;
+        len -= slice_len;
     }
     
-    return offset;
+    return head;
 }
 
-void pip_tcp::received(pip_uint16 len) {
+void pip_tcp::received(pip_uint32 len) {
     if (this->status != pip_tcp_status_established) {
         return;
     }
     
-    this->wind = PIP_MIN(this->wind + len, PIP_TCP_WIND);
-    if (this->wind - len <= 0 && this->ack == this->_last_ack) {
-        /// 当前窗口<=0，并且无等待发送的包 直接发送ack 更新窗口
+    this->wind = PIP_MIN(this->wind + len, this->_rcv_buf);
+    this->autotune_rcv_buf(len);
+    
+    if (this->wind >= this->_adv_wind + PIP_MIN(this->_rcv_buf / 2, (pip_uint32)this->mss) && this->ack == this->_last_ack) {
+        /// 窗口明显变大 并且无等待确认的数据 直接发送ack 更新窗口
         this->send_ack();
     }
 }
 
-void pip_tcp::debug_status() {
-    printf("source %s port %d\n", this->ip_header->src_str, this->src_port);
-    printf("destination %s port %d\n", this->ip_header->dest_str, this->dest_port);
-    printf("wind %hu \n", this->wind);
-    printf("wait ack pkts %d \n", this->_packet_queue->size());
+void pip_tcp::autotune_rcv_buf(pip_uint32 len) {
+    pip_uint64 now = get_current_time();
+    this->_rcv_consumed += len;
+    
+    /// 以一个RTT为周期统计上层读取的速度
+    pip_uint32 rtt = this->_srtt > 0 ? this->_srtt : PIP_TCP_RTO_MIN;
+    if (now - this->_rcv_measure_time < rtt) {
+        return;
+    }
+    
+    pip_uint32 consumed = this->_rcv_consumed;
+    this->_rcv_consumed = 0;
+    this->_rcv_measure_time = now;
+    
+    /// 没有协商窗口扩大时最多通告 0xFFFF 更大的缓冲用不上
+    pip_uint64 rcv_buf_max = PIP_MIN((pip_uint64)PIP_TCP_RCV_BUF_MAX, (pip_uint64)0xFFFF << this->wscale);
+    if ((pip_uint64)consumed * 2 <= this->_rcv_buf || this->_rcv_buf >= rcv_buf_max) {
+        return;
+    }
+    
+    /// 一个RTT内读取了超过一半的缓冲 缓冲扩大到读取量的2倍 受全局上限约束
+    pip_uint64 target = PIP_MIN((pip_uint64)consumed * 2, rcv_buf_max);
+    pip_uint64 grow = target - this->_rcv_buf;
+    if (tcp_rcv_buf_total + grow > PIP_TCP_RCV_BUF_TOTAL) {
+        grow = tcp_rcv_buf_total < PIP_TCP_RCV_BUF_TOTAL ? PIP_TCP_RCV_BUF_TOTAL - tcp_rcv_buf_total : 0;
+    }
     
-    printf("current tcp connections %lu \n", tcp_connections.size());
+    if (grow <= 0) {
+        return;
+    }
+    
+    this->_rcv_buf += grow;
+    this->wind += grow;
+    tcp_rcv_buf_total += grow;
+}
+
+void pip_tcp::debug_status() {
+    printf("source %s port %d\n", pip_ip_to_str(this->src_ip).str, this->src_port);
+    printf("destination %s port %d\n", pip_ip_to_str(this->dest_ip).str, this->dest_port);
+    printf("wind %u rcv_buf %u \n", this->wind, this->_rcv_buf);
+    int resent = 0;
+    for (int i = 0; i < this->_packet_queue.size(); i++) {
+        if (this->_packet_queue.at(i)->get_send_count() > 1) {
+            resent += 1;
+        }
+    }
+    printf("wait ack pkts %d resent %d \n", this->_packet_queue.size(), resent);
+    printf("flight bytes %u lent %u \n", this->_snd_ring.size(), this->_lent_len);
+    printf("reass segs %u bytes %u \n", this->_reass.count(), this->_reass.bytes());
+    printf("srtt %u rttvar %u rto %u \n", this->_srtt, this->_rttvar, this->_rto);
+    printf("cwnd %u ssthresh %u \n", this->_cwnd, this->_ssthresh);
+    printf("acks sent %llu saved %llu \n", (unsigned long long)this->stats.acks_sent, (unsigned long long)this->stats.acks_saved);
+    printf("retransmits fast %llu timeout %llu \n", (unsigned long long)this->stats.fast_retransmits, (unsigned long long)this->stats.timeout_retransmits);
+    
+    printf("current tcp connections %u \n", tcp_connections.size());
     printf("\n\n");
 }
 
@@ -341,7 +957,28 @@ pip_uint32 pip_tcp::get_iden() {
 }
 
 bool pip_tcp::can_write() {
-    return this->_is_wait_push_ack == false;
+    if (this->send_window() <= 0) {
+        return false;
+    }
+    
+    /// 发送缓冲已满且不能扩大时 超出内存预算不能写
+    return this->_snd_ring.space() > 0 || pip_mem::available(PIP_MAX(this->_snd_ring.capacity(), (pip_uint32)PIP_TCP_SND_RING_MIN));
+}
+
+pip_uint32 pip_tcp::send_window() {
+    pip_uint32 limit = PIP_MIN(this->snd_buf, (pip_uint32)this->opp_wind);
+    limit = PIP_MIN(limit, this->_cwnd);
+    
+    if (pip_mem::is_pressured()) {
+        /// 内存紧张 每个连接只保留少量未确认数据
+        limit = PIP_MIN(limit, (pip_uint32)PIP_TCP_SND_BUF_SOFT);
+    }
+    
+    pip_uint32 flight = this->flight_size();
+    if (flight >= limit) {
+        return 0;
+    }
+    return limit - flight;
 }
 
 // MARK: - Send
@@ -350,35 +987,87 @@ void pip_tcp::send_packet(pip_tcp_packet *packet) {
     packet->sended();
     tcphdr * hdr = packet->get_hdr();
     pip_uint16 datalen = packet->get_payload_len();
-    pip_netif::shared()->output(packet->get_head_buf(), IPPROTO_TCP, this->ip_header->dest, this->ip_header->src);
+    pip_netif::shared()->output(packet->get_head_buf(), &this->_header_template.ip);
     
-    this->_last_ack = ntohl(hdr->th_ack);
+    bool is_pure_ack = hdr->th_flags == TH_ACK && datalen == 0;
+    if (is_pure_ack) {
+        this->stats.acks_sent += 1;
+        tcp_global_stats.acks_sent += 1;
+    }
+    
+    this->sent_ack(hdr, is_pure_ack);
     
     this->seq = increase_seq(this->seq, hdr->th_flags, datalen);
     
+    if (!this->_retransmit_timer.is_scheduled() && !this->_packet_queue.empty()) {
+        this->restart_retransmit_timer();
+    }
+    
 #if PIP_DEBUG
     pip_debug_output_tcp(this, packet, "tcp_send");
 #endif
 }
     
+void pip_tcp::sent_ack(struct tcphdr * hdr, bool is_pure_ack) {
+    this->_last_ack = ntohl(hdr->th_ack);
+    this->_adv_wind = (pip_uint32)ntohs(hdr->th_win) << ((hdr->th_flags & TH_SYN) ? 0 : this->wscale);
+    
+    if ((hdr->th_flags & TH_ACK) && this->_ack_pending > 0) {
+        /// 等待确认的数据段合并在这一个包里确认
+        pip_uint32 saved = is_pure_ack ? this->_ack_pending - 1 : this->_ack_pending;
+        this->stats.acks_saved += saved;
+        tcp_global_stats.acks_saved += saved;
+        
+        this->_ack_pending = 0;
+        tcp_timer_wheel()->cancel(&this->_ack_timer);
+    }
+}
+
 void
 pip_tcp::resend_packet(pip_tcp_packet *packet) {
+    /// 重传的包同时确认最新收到的数据
+    packet->refresh(this);
     packet->sended();
-    pip_netif::shared()->output(packet->get_head_buf(), IPPROTO_TCP, this->ip_header->dest, this->ip_header->src);
+    pip_netif::shared()->output(packet->get_head_buf(), &this->_header_template.ip);
+    this->sent_ack(packet->get_hdr(), false);
     
 #if PIP_DEBUG
     pip_debug_output_tcp(this, packet, "tcp_resend");
 #endif
 }
 
+void pip_tcp::fast_retransmit() {
+    if (this->_packet_queue.empty()) {
+        return;
+    }
+    
+    this->stats.fast_retransmits += 1;
+    tcp_global_stats.fast_retransmits += 1;
+    this->resend_packet(this->_packet_queue.front());
+    this->restart_retransmit_timer();
+}
+
 void pip_tcp::send_ack() {
     pip_tcp_packet * packet = new pip_tcp_packet(this, TH_ACK, NULL, NULL, "pip_tcp::send_ack");
     this->send_packet(packet);
     delete packet;
 }
 
+void pip_tcp::send_window_probe() {
+    /// 发送缓冲中没有待发的数据 用已确认过的序号探测 不占用新的序号
+    this->seq -= 1;
+    pip_tcp_packet * packet = new pip_tcp_packet(this, TH_ACK, NULL, NULL, "pip_tcp::send_window_probe");
+    this->seq += 1;
+    
+    this->send_packet(packet);
+    delete packet;
+    
+    this->stats.window_probes += 1;
+    tcp_global_stats.window_probes += 1;
+}
+
 // MARK: - Handle
-void pip_tcp::handle_ack(pip_uint32 ack) {
+void pip_tcp::handle_ack(pip_uint32 ack, bool maybe_dup, bool was_blocked) {
     
 #if PIP_DEBUG
     printf("[tcp_handle_ack]:\n");
@@ -387,22 +1076,54 @@ void pip_tcp::handle_ack(pip_uint32 ack) {
     
     bool has_syn = false;
     bool has_fin = false;
+    bool has_acked = false;
     pip_uint32 written_length = 0;
+    pip_uint64 rtt_send_time = 0;
     
-    while (this->_packet_queue->size() > 0) {
-        pip_tcp_packet * pkt = this->_packet_queue->front();
+    while (this->_packet_queue.size() > 0) {
+        pip_tcp_packet * pkt = this->_packet_queue.front();
         struct tcphdr * hdr = pkt->get_hdr();
         
-        pip_uint32 seq = ntohl(hdr->th_seq) + pkt->get_payload_len();
+        pip_uint32 pkt_seq = ntohl(hdr->th_seq);
+        pip_uint32 seq = increase_seq(pkt_seq, hdr->th_flags, pkt->get_payload_len());
         
-        if (hdr == NULL || is_before_seq(seq, ack) == false) {
+        if (is_before_seq(seq, ack) == false) {
+            
+            if (pkt->get_payload_len() > 0 && !is_before_seq(ack, pkt_seq)) {
+                /// 数据包被部分确认 释放已确认的字节 剩余部分重新组包
+                pip_uint32 acked = ack - pkt_seq;
+                this->release_acked(pkt, acked);
+                written_length += acked;
+                has_acked = true;
+                
+                if (pkt->get_send_count() == 1) {
+                    rtt_send_time = pkt->get_send_time();
+                }
+                
+                /// 队首数据包之前的数据都已释放 剩余部分在发送缓冲头部
+                pip_tcp_lent * lent = pkt->get_lent();
+                pip_uint32 offset = 0;
+                if (lent) {
+                    /// 剩余部分可能从之后借出的缓冲开始 前面的缓冲确认后会被释放
+                    offset = pkt->get_lent_offset() + acked;
+                    seek_lent(&lent, &offset);
+                    pkt->set_lent(lent, offset);
+                }
+                pkt->trim(this, acked, this->payload_buf(lent, offset, pkt->get_payload_len() - acked));
+            }
+            
 #if PIP_DEBUG
-            if (hdr)
-                printf("break seq: %d ack: %d\n", ntohl(hdr->th_seq), ack);
+            printf("break seq: %d ack: %d\n", pkt_seq, ack);
 #endif
             break;
         }
-        this->_packet_queue->pop();
+        this->_packet_queue.pop();
+        has_acked = true;
+        
+        /// Karn 算法 重传过的包不参与RTT采样
+        if (pkt->get_send_count() == 1) {
+            rtt_send_time = pkt->get_send_time();
+        }
         
         if (hdr->th_flags & TH_SYN) {
             this->status = pip_tcp_status_established;
@@ -410,10 +1131,7 @@ void pip_tcp::handle_ack(pip_uint32 ack) {
         }
         
         if (pkt->get_payload_len() > 0) {
-            if (hdr->th_flags & TH_PUSH) {
-                this->_is_wait_push_ack = false;
-            }
-            
+            this->release_acked(pkt, pkt->get_payload_len());
             written_length += pkt->get_payload_len();
         }
         
@@ -424,8 +1142,71 @@ void pip_tcp::handle_ack(pip_uint32 ack) {
         delete pkt;
     }
     
+    /// 回调中可能继续写入 在遍历队列之后归还
+    this->release_lent(false);
+    this->shrink_ring();
+    
+    if (rtt_send_time > 0) {
+        this->update_rtt((pip_uint32)(get_current_time() - rtt_send_time));
+    }
+    
+    if (has_acked) {
+        /// 有新数据确认 按队首重新计时
+        this->_dup_acks = 0;
+        this->restart_retransmit_timer();
+        
+        if (this->_in_recovery) {
+            /// is_before_seq 包含相等 确认到 _recover 是完整确认
+            if (!is_before_seq(this->_recover, ack)) {
+                /// NewReno 部分确认 下一个丢失的数据包立即重传
+                /// RFC 6582 拥塞窗口减去确认的数据 确认了至少一个数据段时加回一个
+                this->fast_retransmit();
+                this->_cwnd -= PIP_MIN(this->_cwnd, written_length);
+                if (written_length >= this->opp_mss) {
+                    this->_cwnd += this->opp_mss;
+                }
+                this->_cwnd = PIP_MAX(this->_cwnd, (pip_uint32)this->opp_mss);
+            } else {
+                /// 退出快速恢复 拥塞窗口回到阈值 不超过在途数据加一个数据段
+                this->_in_recovery = false;
+                this->_cwnd = PIP_MIN(this->_ssthresh, PIP_MAX(this->flight_size(), (pip_uint32)this->opp_mss) + this->opp_mss);
+            }
+            
+        } else {
+            if (this->_rto_recovery) {
+                if (!is_before_seq(this->_recover, ack) && !this->_packet_queue.empty()) {
+                    /// 超时重传后的部分确认 队首是超时前发出还没确认的数据 立即重传
+                    this->stats.timeout_retransmits += 1;
+                    tcp_global_stats.timeout_retransmits += 1;
+                    this->resend_packet(this->_packet_queue.front());
+                    this->restart_retransmit_timer();
+                } else {
+                    this->_rto_recovery = false;
+                }
+            }
+            this->grow_cwnd(written_length);
+        }
+        
+    } else if (maybe_dup && !this->_packet_queue.empty() && ack == ntohl(this->_packet_queue.front()->get_hdr()->th_seq)) {
+        /// 重复ACK 队首数据包可能丢失
+        this->_dup_acks += 1;
+        
+        if (this->_dup_acks == PIP_TCP_DUP_ACK_THRESH && !this->_in_recovery && is_before_seq(this->_recover, ack)) {
+            /// 快速重传 进入快速恢复 直到确认进入时已发送的全部数据
+            this->reduce_ssthresh();
+            this->_cwnd = this->_ssthresh + PIP_TCP_DUP_ACK_THRESH * this->opp_mss;
+            this->_in_recovery = true;
+            this->_recover = this->seq;
+            this->fast_retransmit();
+            
+        } else if (this->_in_recovery && this->_dup_acks > PIP_TCP_DUP_ACK_THRESH) {
+            /// 快速恢复中每个重复ACK表示一个数据段离开网络 膨胀拥塞窗口允许发送新数据
+            this->_cwnd += this->opp_mss;
+        }
+    }
+    
 #if PIP_DEBUG
-    printf("remain packet num: %d\n", this->_packet_queue->size());
+    printf("remain packet num: %d\n", this->_packet_queue.size());
     printf("\n\n");
 #endif
     
@@ -435,7 +1216,8 @@ void pip_tcp::handle_ack(pip_uint32 ack) {
         }
     }
     
-    if (written_length > 0) {
+    if (written_length > 0 || (was_blocked && this->send_window() > 0)) {
+        /// 有数据被确认 或者窗口重新打开 通知上层继续写入
         if (this->written_callback) {
             this->written_callback(this, written_length);
         }
@@ -445,7 +1227,7 @@ void pip_tcp::handle_ack(pip_uint32 ack) {
         if (this->status == pip_tcp_status_fin_wait_1) {
             /// 主动关闭 改变状态
             this->status = pip_tcp_status_fin_wait_2;
-            this->_fin_time = get_current_time();
+            this->start_fin_timer();
             
         } else if (this->status == pip_tcp_status_close_wait) {
             /// 被动关闭 清理资源
@@ -464,6 +1246,10 @@ void pip_tcp::handle_syn(void * options, pip_uint16 optionlen) {
     printf("option len: %d\n", optionlen);
     printf("\n");
 #endif
+    /// 对方未携带mss时使用默认值
+    this->opp_mss = 536;
+    
+    bool has_wscale = false;
     if (optionlen > 0) {
         pip_uint8 * bytes = (pip_uint8 *)options;
         pip_uint16 offset = 0;
@@ -478,6 +1264,11 @@ void pip_tcp::handle_syn(void * options, pip_uint16 optionlen) {
                 break;
             }
             
+            /// 除 NOP 之外的选项都有长度字节 长度字节超出选项区域时停止解析
+            if (kind != 1 && offset + 1 >= optionlen) {
+                break;
+            }
+            
             switch (kind) {
                 case 1: {
                     offset += 1;
@@ -487,12 +1278,29 @@ void pip_tcp::handle_syn(void * options, pip_uint16 optionlen) {
                 case 2: {
                     // mss
                     pip_uint8 len = bytes[offset + 1];
-                    pip_uint16 mss = 0;
-                    memcpy(&mss, bytes + offset + 2, len - offset - 2);
-                    this->opp_mss = ntohs(mss);
+                    if (len == 4 && offset + len <= optionlen) {
+                        pip_uint16 mss = 0;
+                        memcpy(&mss, bytes + offset + 2, 2);
+                        this->opp_mss = ntohs(mss);
 #if PIP_DEBUG
-                    printf("mss: %d", ntohs(mss));
+                        printf("mss: %d", ntohs(mss));
 #endif
+                    }
+                    
+                    offset += len;
+                    break;
+                }
+                    
+                case 3: {
+                    // window scale
+                    pip_uint8 len = bytes[offset + 1];
+                    if (len == 3 && offset + len <= optionlen) {
+                        has_wscale = true;
+                        this->opp_wscale = PIP_MIN(bytes[offset + 2], PIP_TCP_WSCALE_MAX);
+#if PIP_DEBUG
+                        printf("wscale: %d", this->opp_wscale);
+#endif
+                    }
                     
                     offset += len;
                     break;
@@ -510,9 +1318,24 @@ void pip_tcp::handle_syn(void * options, pip_uint16 optionlen) {
 #if PIP_DEBUG
     printf("\n\n");
 #endif
-    pip_buf * option_buf = new pip_buf(4);
+    if (has_wscale) {
+        /// 对方支持窗口扩大 按接收缓冲上限计算己方的扩大因子
+        this->wscale = 0;
+        while ((PIP_TCP_RCV_BUF_MAX >> this->wscale) > 0xFFFF && this->wscale < PIP_TCP_WSCALE_MAX) {
+            this->wscale += 1;
+        }
+    } else {
+        this->wscale = 0;
+        this->opp_wscale = 0;
+    }
+    
+    /// RFC 6928 初始拥塞窗口 min(10 * MSS, max(2 * MSS, 14600))
+    this->_cwnd = PIP_MIN(PIP_TCP_INIT_CWND * (pip_uint32)this->opp_mss, PIP_MAX(2 * (pip_uint32)this->opp_mss, (pip_uint32)14600));
+    
+    pip_uint16 option_len = has_wscale ? 8 : 4;
+    pip_buf * option_buf = new pip_buf(option_len);
     pip_uint8 * optionBuffer = (pip_uint8 *)option_buf->payload;
-    memset(optionBuffer, 0, 4);
+    memset(optionBuffer, 0, option_len);
     if (true) {
         // mss
         pip_uint8 kind = 2;
@@ -524,8 +1347,16 @@ void pip_tcp::handle_syn(void * options, pip_uint16 optionlen) {
         memcpy(optionBuffer + 2, &value, 2);
     }
     
+    if (has_wscale) {
+        // nop + window scale
+        optionBuffer[4] = 1;
+        optionBuffer[5] = 3;
+        optionBuffer[6] = 3;
+        optionBuffer[7] = this->wscale;
+    }
+    
     pip_tcp_packet * packet = new pip_tcp_packet(this, TH_SYN | TH_ACK, option_buf, NULL, "pip_tcp::handle_syn");
-    this->_packet_queue->push(packet);
+    this->_packet_queue.push(packet);
     this->send_packet(packet);
 }
 
@@ -552,17 +1383,18 @@ void pip_tcp::handle_fin() {
 //        delete packet;
 //
         pip_tcp_packet * packet = new pip_tcp_packet(this, TH_FIN | TH_ACK, NULL, NULL, "pip_tcp::handle_fin2");
-        this->_packet_queue->push(packet);
+        this->_packet_queue.push(packet);
         this->send_packet(packet);
     }
 }
 
-void pip_tcp::handle_push(void *data, pip_uint16 datalen) {
+void pip_tcp::handle_push(void *data, pip_uint32 datalen) {
+    /// PUSH 数据立即确认
+    this->_ack_now = true;
     this->handle_receive(data, datalen);
-    
 }
 
-void pip_tcp::handle_receive(void *data, pip_uint16 datalen) {
+void pip_tcp::handle_receive(void *data, pip_uint32 datalen) {
 
     
 #if PIP_DEBUG
@@ -570,14 +1402,105 @@ void pip_tcp::handle_receive(void *data, pip_uint16 datalen) {
     printf("receive data: %d\n", datalen);
     printf("\n\n");
 #endif
-    this->wind -= datalen;
+    /// 先记录待确认 回调中写出的数据会捎带确认
+    if (datalen > 0) {
+        this->_ack_pending += 1;
+    }
+    
+    this->deliver_data(data, datalen);
+    
+    if (datalen > 0) {
+        this->delay_ack();
+    }
+    this->_ack_now = false;
+}
+
+void pip_tcp::handle_reass_fill(void * data, pip_uint32 datalen, pip_uint32 reass_seq) {
+    this->_ack_pending += 1;
+    this->deliver_data(data, datalen);
+    
+    /// 重组队列中的数据直接交给上层 不合并复制
+    const pip_uint8 * reass_data = NULL;
+    pip_uint32 len = 0;
+    while ((len = this->_reass.front(reass_seq, &reass_data)) > 0) {
+        this->deliver_data((void *)reass_data, len);
+        this->_reass.pop();
+        reass_seq += len;
+    }
+    
+    this->delay_ack();
+    this->_ack_now = false;
+}
+
+void pip_tcp::deliver_data(void * data, pip_uint32 datalen) {
+    this->wind = datalen > this->wind ? 0 : this->wind - datalen;
     if (this->received_callback) {
         this->received_callback(this, data, datalen);
     }
+}
+
+void pip_tcp::delay_ack() {
+    if (this->_ack_pending <= 0) {
+        /// 已经随数据一起确认
+        return;
+    }
     
-    if (datalen > 0) {
-        this->send_ack();
+    if (!this->delayed_ack || this->_ack_now || this->_ack_pending >= 2) {
+        if (!this->defer_ack()) {
+            this->send_ack();
+        }
+        return;
+    }
+    
+    if (!this->_ack_timer.is_scheduled()) {
+        tcp_timer_wheel()->schedule(&this->_ack_timer, get_current_time() + PIP_TCP_DELAYED_ACK_TIME);
+    }
+}
+
+bool pip_tcp::defer_ack() {
+    if (!tcp_batching) {
+        return false;
+    }
+    
+    if (this->_ack_deferred) {
+        return true;
+    }
+    
+    if (tcp_batch_ack_count >= PIP_NETIF_BATCH_MAX) {
+        return false;
+    }
+    
+    tcp_batch_acks[tcp_batch_ack_count++] = this;
+    this->_ack_deferred = true;
+    return true;
+}
+
+void pip_tcp::begin_batch() {
+    tcp_batching = true;
+}
+
+void pip_tcp::end_batch() {
+    tcp_batching = false;
+    
+    for (int i = 0; i < tcp_batch_ack_count; i++) {
+        pip_tcp * tcp = tcp_batch_acks[i];
+        if (tcp == NULL) {
+            continue;
+        }
+        
+        tcp->_ack_deferred = false;
+        
+        /// 空缺还在时 乱序数据的重复确认按收到的个数补发 最多到对方触发快速重传需要的数量
+        int dups = tcp->_reass.empty() ? 0 : tcp->_dup_acks_deferred;
+        if (tcp->_ack_pending > 0 || tcp->_dup_acks_deferred > 0) {
+            tcp->send_ack();
+        }
+        for (int j = 1; j < dups; j++) {
+            tcp->send_ack();
+        }
+        tcp->_dup_acks_deferred = 0;
     }
+    tcp_batch_ack_count = 0;
 }
 
 // MARK: - Input
@@ -588,24 +1511,38 @@ void pip_tcp::input(const void * bytes, pip_ip_header * ip_header) {
     pip_uint16 dport = ntohs(hdr->th_dport);
     pip_uint16 sport = ntohs(hdr->th_sport);
     
-    if (!(dport >= 1 && dport <= 65535)) {
-        delete ip_header;
+    if (dport == 0) {
         return;
     }
     
-    pip_uint32 iden = ip_header->src ^ ip_header->dest ^ dport ^ sport;
-    pip_tcp * tcp = fetch_tcp_connection(iden);
+    pip_flow_key key;
+    key.src = ip_header->src;
+    key.dest = ip_header->dest;
+    key.src_port = sport;
+    key.dest_port = dport;
+    
+    pip_tcp * tcp = fetch_tcp_connection(key);
     
     if (tcp == NULL && hdr->th_flags & TH_SYN && tcp_connections.size() < PIP_TCP_MAX_CONNS) {
-        tcp = new pip_tcp;
-        tcp->_iden = iden;
-        
-        tcp->ip_header = ip_header;
-        
-        tcp->src_port = sport;
-        tcp->dest_port = dport;
-        
-        tcp_connections[iden] = tcp;
+        if (pip_mem::charge(pip_mem_type_tcp_conn, sizeof(pip_tcp))) {
+            tcp = new pip_tcp;
+            tcp->_mem_charged = true;
+            tcp->_flow_key = key;
+            tcp->_iden = tcp_connections.hash(key);
+            
+            tcp->src_ip = ip_header->src;
+            tcp->dest_ip = ip_header->dest;
+            
+            tcp->src_port = sport;
+            tcp->dest_port = dport;
+            tcp->init_header_template();
+            
+            tcp_connections.insert(key, tcp);
+            
+        } else {
+            /// 超出内存预算 拒绝新连接 下面按不存在的连接回复RST
+            pip_mem::refuse_syn();
+        }
     }
     
     
@@ -615,17 +1552,18 @@ void pip_tcp::input(const void * bytes, pip_ip_header * ip_header) {
     
     if (tcp == NULL) {
         
-        if (hdr->th_flags & TH_RST) {
-            delete ip_header;
-        } else {
+        if (!(hdr->th_flags & TH_RST)) {
             // 不存在的连接 直接返回RST
             tcp = new pip_tcp;
-            tcp->_iden = iden;
+            tcp->_flow_key = key;
+            tcp->_iden = tcp_connections.hash(key);
             
-            tcp->ip_header = ip_header;
+            tcp->src_ip = ip_header->src;
+            tcp->dest_ip = ip_header->dest;
             
             tcp->src_port = ntohs(hdr->th_sport);
             tcp->dest_port = dport;
+            tcp->init_header_template();
             
             tcp->seq = ntohl(hdr->th_ack);
             tcp->ack = increase_seq(ntohl(hdr->th_seq), hdr->th_flags, datalen);
@@ -644,43 +1582,97 @@ void pip_tcp::input(const void * bytes, pip_ip_header * ip_header) {
         return;
     }
     
-    if (tcp->ip_header != ip_header) {
-        delete ip_header;
-    }
-    
     if (hdr->th_flags == TH_ACK && ntohl(hdr->th_seq) == tcp->ack - 1) {
         // keep-alive 包 直接回复
         tcp->send_ack();
         return;
     }
     
-    if (tcp->ack > 0) {
-        if (ntohl(hdr->th_seq) != tcp->ack) {
+    pip_uint32 seg_seq = ntohl(hdr->th_seq);
+    pip_uint8 flags = hdr->th_flags;
+    pip_uint8 * data = (pip_uint8 *)bytes + hdr->th_off * 4;
+    pip_uint32 seg_len = datalen;
+    
+    if (tcp->ack > 0 && seg_seq != tcp->ack) {
+        
+        if (seg_len > 0 && is_before_seq(seg_seq, tcp->ack) && !is_before_seq(seg_seq + seg_len, tcp->ack)) {
+            /// 部分数据已经接收过 裁掉重复部分
+            pip_uint32 d = tcp->ack - seg_seq;
+            data += d;
+            seg_len -= d;
+            seg_seq = tcp->ack;
+            flags &= ~TH_SYN;
+            
+        } else {
+            
+            if (seg_len > 0 &&
+                tcp->status == pip_tcp_status_established &&
+                !is_before_seq(seg_seq, tcp->ack) &&
+                seg_seq + seg_len - tcp->ack <= tcp->wind) {
+                /// 窗口内的乱序数据 先缓存等待前面的数据到达
+                tcp->_reass.insert(seg_seq, data, seg_len, flags, tcp->_rcv_buf);
+            }
+            
             /// 当前数据包seq与之前的ack对不上 产生了丢包 回复之前的ack 等待重传
-            tcp->send_ack();
+            /// 批量输入中挂起到批次结束 和同一批的其他确认合并
+            if (tcp->defer_ack()) {
+                if (tcp->_dup_acks_deferred < PIP_TCP_DUP_ACK_THRESH) {
+                    tcp->_dup_acks_deferred += 1;
+                }
+            } else {
+                tcp->send_ack();
+            }
             return;
         }
     }
     
-    tcp->ack = increase_seq(ntohl(hdr->th_seq), hdr->th_flags, datalen);
-    tcp->opp_wind = ntohs(hdr->th_win);
+    tcp->ack = increase_seq(seg_seq, flags, seg_len);
+    
+    /// 重复ACK不带数据 不改变窗口
+    pip_uint32 old_opp_wind = tcp->opp_wind;
+    bool was_blocked = tcp->status == pip_tcp_status_established && tcp->send_window() <= 0;
+    
+    /// SYN 中的窗口不扩大
+    if (flags & TH_SYN) {
+        tcp->opp_wind = ntohs(hdr->th_win);
+    } else {
+        tcp->opp_wind = (pip_uint32)ntohs(hdr->th_win) << tcp->opp_wscale;
+    }
     
+    bool maybe_dup = seg_len == 0 && !(flags & (TH_SYN | TH_FIN)) && tcp->opp_wind == old_opp_wind;
+    
+    pip_uint32 more = 0;
+    if (seg_len > 0 && !(flags & TH_FIN) && !tcp->_reass.empty()) {
+        /// 空缺已补上 后续连续的乱序数据之后一起确认
+        pip_uint8 reass_flags = 0;
+        more = tcp->_reass.contiguous_len(tcp->ack, &reass_flags);
+        if (more > 0) {
+            /// 补上空缺 立即确认
+            tcp->_ack_now = true;
+            flags |= reass_flags & (TH_PUSH | TH_FIN);
+            tcp->ack = increase_seq(tcp->ack + more, reass_flags & TH_FIN, 0);
+        }
+    }
     
-    if (hdr->th_flags & TH_PUSH) {
-        tcp->handle_push((pip_uint8 *)bytes + hdr->th_off * 4, datalen);
-    } else if (datalen > 0) {
-        tcp->handle_receive((pip_uint8 *)bytes + hdr->th_off * 4, datalen);
+    if (more > 0) {
+        tcp->handle_reass_fill(data, seg_len, seg_seq + seg_len);
+    } else if (flags & TH_PUSH) {
+        tcp->handle_push(data, seg_len);
+    } else if (seg_len > 0) {
+        tcp->handle_receive(data, seg_len);
     }
     
     if (hdr->th_flags & TH_ACK) {
-        tcp->handle_ack(ntohl(hdr->th_ack));
+        tcp->handle_ack(ntohl(hdr->th_ack), maybe_dup, was_blocked);
     }
     
-    if (fetch_tcp_connection(iden) == NULL) {
+    if (fetch_tcp_connection(key) != tcp) {
         /// 防止 tcp 在handle_ack里释放了继续执行崩溃
         return;
     }
     
+    tcp->update_persist_timer();
+    
     if (hdr->th_flags & TH_RST) {
         // RST 标志直接释放
         tcp->release("pip_tcp::input");
@@ -695,7 +1687,7 @@ void pip_tcp::input(const void * bytes, pip_ip_header * ip_header) {
         }
     }
     
-    if (hdr->th_flags & TH_FIN) {
+    if (flags & TH_FIN) {
         tcp->handle_fin();
     }
 }
@@ -707,13 +1699,14 @@ pip_tcp_packet(pip_tcp *tcp, pip_uint8 flags, pip_buf * option_buf, pip_buf * pa
     
     this->_send_time = 0;
     this->_send_count = 0;
+    this->_lent = NULL;
+    this->_lent_offset = 0;
     
-    pip_uint8 * buffer = (pip_uint8 *)calloc(1, sizeof(struct tcphdr));
-    this->_buffer = buffer;
     this->_debug_iden = debug_iden;
     
-    // -- 赋值BUF
-    pip_buf * head_buf = new pip_buf(buffer, sizeof(struct tcphdr), 0);
+    // -- 赋值BUF 头部前面预留IP头部空间
+    pip_buf * head_buf = new pip_buf(this->_buffer + PIP_IP_HEADROOM, sizeof(struct tcphdr), 0);
+    head_buf->headroom = PIP_IP_HEADROOM;
     if (option_buf != NULL) {
         option_buf->set_next(payload_buf);
         head_buf->set_next(option_buf);
@@ -723,6 +1716,7 @@ pip_tcp_packet(pip_tcp *tcp, pip_uint8 flags, pip_buf * option_buf, pip_buf * pa
     
     
     this->_head_buf = head_buf;
+    this->_option_buf = option_buf;
 
 
     if (payload_buf) {
@@ -731,90 +1725,120 @@ pip_tcp_packet(pip_tcp *tcp, pip_uint8 flags, pip_buf * option_buf, pip_buf * pa
         this->_payload_len = 0;
     }
     
-    // - 填充头部
-    int offset = 0;
-    if (true) {
-        // 源端口
-        int len = sizeof(pip_uint16);
-        pip_uint16 port = htons(tcp->dest_port);
-        memcpy(buffer + offset, &port, len);
-        
-        offset += len;
+    this->fill_header(tcp, tcp->seq, flags);
+}
+
+void
+pip_tcp_packet::trim(pip_tcp *tcp, pip_uint32 len, pip_buf * payload_buf) {
+    struct tcphdr * hdr = this->get_hdr();
+    pip_uint32 seq = ntohl(hdr->th_seq) + len;
+    
+    /// 替换数据部分 数据包只有头部和数据 没有选项
+    pip_buf * old_payload = this->_head_buf->next;
+    this->_head_buf->set_next(payload_buf);
+    if (old_payload) {
+        delete old_payload;
     }
     
-    if (true) {
-        // 目标端口
-        int len = sizeof(pip_uint16);
-        pip_uint16 port = htons(tcp->src_port);
-        memcpy(buffer + offset, &port, len);
-        
-        offset += len;
+    this->_payload_len = payload_buf ? payload_buf->total_len : 0;
+    this->fill_header(tcp, seq, hdr->th_flags);
+}
+
+void
+pip_tcp_packet::set_lent(pip_tcp_lent * lent, pip_uint32 offset) {
+    this->_lent = lent;
+    this->_lent_offset = offset;
+}
+
+pip_tcp_lent *
+pip_tcp_packet::get_lent() {
+    return this->_lent;
+}
+
+pip_uint32
+pip_tcp_packet::get_lent_offset() {
+    return this->_lent_offset;
+}
+
+void
+pip_tcp_packet::refresh(pip_tcp *tcp) {
+    struct tcphdr * hdr = this->get_hdr();
+    if (!(hdr->th_flags & TH_ACK)) {
+        return;
     }
     
-    if (true) {
-        // 序号
-        int len = sizeof(pip_uint32);
-        pip_uint32 seq = htonl(tcp->seq);
-        memcpy(buffer + offset, &seq, len);
-        
-        offset += len;
+    pip_uint32 ack = htonl(tcp->ack);
+    pip_uint16 wind = htons(tcp->header_wind(hdr->th_flags));
+    
+    if (pip_netif::shared()->is_checksum_offload()) {
+        /// 校验和字段只有伪头部 不随这些字段变化
+        hdr->th_ack = ack;
+        hdr->th_win = wind;
+        return;
     }
     
-    if (true) {
-        // 确认号
-        int len = sizeof(pip_uint32);
-        pip_uint32 ack = htonl(tcp->ack);
-        memcpy(buffer + offset, &ack, len);
-        
-        offset += len;
+    pip_uint16 checksum = hdr->th_sum;
+    if (hdr->th_ack != ack) {
+        checksum = pip_checksum_adjust32(checksum, hdr->th_ack, ack);
+        hdr->th_ack = ack;
     }
     
+    if (hdr->th_win != wind) {
+        checksum = pip_checksum_adjust16(checksum, hdr->th_win, wind);
+        hdr->th_win = wind;
+    }
+    hdr->th_sum = checksum;
+}
+
+void
+pip_tcp_packet::fill_header(pip_tcp *tcp, pip_uint32 seq, pip_uint8 flags) {
+    const pip_tcp_template * tmpl = &tcp->_header_template;
+    struct tcphdr * hdr = this->get_hdr();
     
-    if (true) {
-        // 头部长度 保留 标识
-        int len = sizeof(pip_uint16);
-        pip_uint16 h_flags = 0;
-        
-        pip_uint16 headlen = head_buf->payload_len;
-        if (option_buf != NULL) {
-            headlen += option_buf->payload_len;
-        }
-        
-        h_flags = (headlen / 4) << 12;
-        h_flags = h_flags | flags;
-        h_flags = htons(h_flags);
-        memcpy(buffer + offset, &h_flags, len);
-        
-        offset += len;
+    pip_uint16 headlen = this->_head_buf->payload_len;
+    if (this->_option_buf != NULL) {
+        headlen += this->_option_buf->payload_len;
     }
     
+    // 头部长度 保留 标识
+    pip_uint16 h_flags = ((headlen / 4) << 12) | flags;
     
-    if (true) {
-        // 窗口大小
-        int len = sizeof(pip_uint16);
-        pip_uint16 wind = htons(tcp->wind);
-        memcpy(buffer + offset, &wind, len);
-        
-        offset += len;
-    }
+    // 窗口大小
+    pip_uint16 wind = tcp->header_wind(flags);
     
-    // 校验和偏移
-    int checksum_offset = offset;
-    offset += sizeof(pip_uint16);
+    // - 端口来自模板 只填充可变字段
+    hdr->th_sport = tmpl->sport;
+    hdr->th_dport = tmpl->dport;
+    hdr->th_seq = htonl(seq);
+    hdr->th_ack = htonl(tcp->ack);
     
-    // 紧急指针
-    offset += sizeof(pip_uint16);
+    pip_uint16 value16 = htons(h_flags);
+    memcpy((pip_uint8 *)hdr + 12, &value16, sizeof(pip_uint16));
     
+    hdr->th_win = htons(wind);
+    hdr->th_sum = 0;
+    hdr->th_urp = 0;
     
-    if (true) {
-        // 计算校验和
-        
-        pip_uint16 checksum = pip_inet_checksum_buf(head_buf, IPPROTO_TCP, tcp->ip_header->dest, tcp->ip_header->src);
-        checksum = htons(checksum);
-        memcpy(buffer + checksum_offset, &checksum, sizeof(pip_uint16));
+    if (pip_netif::shared()->is_checksum_offload()) {
+        /// 只填伪头部的和 不取反 由内核从TCP头部开始补全 模板的部分和包含端口 这里不能使用
+        pip_uint32 sum = pip_inet_pseudo_sum(IPPROTO_TCP, tcp->dest_ip, tcp->src_ip);
+        sum += (pip_uint16)this->_head_buf->total_len;
+        hdr->th_sum = htons(pip_checksum_fold(sum));
+        return;
     }
     
+    // 计算校验和 模板部分和加上长度和可变字段 再加上选项和数据
+    pip_uint32 sum = tmpl->sum;
+    sum += (pip_uint16)this->_head_buf->total_len;
+    sum += (seq >> 16) + (seq & 0xFFFF);
+    sum += (tcp->ack >> 16) + (tcp->ack & 0xFFFF);
+    sum += h_flags;
+    sum += wind;
+    if (this->_head_buf->next) {
+        sum += pip_buf_checksum_sum(this->_head_buf->next);
+    }
     
+    hdr->th_sum = htons(pip_checksum_finish(sum));
 }
 
 pip_tcp_packet::
@@ -824,20 +1848,33 @@ pip_tcp_packet::
         delete this->_head_buf;
         this->_head_buf = NULL;
     }
-    
-    if (this->_buffer) {
-        free(this->_buffer);
-        this->_buffer = NULL;
+}
+
+void *
+pip_tcp_packet::operator new(size_t) {
+    void * ptr = get_pool()->alloc();
+    if (ptr == NULL) {
+        throw std::bad_alloc();
     }
+    return ptr;
+}
+
+void
+pip_tcp_packet::operator delete(void * ptr) {
+    get_pool()->free(ptr);
+}
+
+pip_pool *
+pip_tcp_packet::get_pool() {
+    /// 不释放 保证晚于所有对象销毁
+    static pip_pool * pool = new pip_pool(sizeof(pip_tcp_packet), PIP_POOL_SLAB_OBJECTS);
+    return pool;
 }
 
 
 struct tcphdr *
 pip_tcp_packet::get_hdr() {
-    if (this->_buffer) {
-        return (struct tcphdr *)this->_buffer;
-    }
-    return NULL;
+    return (struct tcphdr *)(this->_buffer + PIP_IP_HEADROOM);
 }
 
 pip_buf *
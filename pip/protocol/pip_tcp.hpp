@@ -11,6 +11,11 @@
 #include "pip_queue.hpp"
 #include "pip_buf.hpp"
 #include "pip_ip_header.hpp"
+#include "pip_flow_table.hpp"
+#include "pip_timer.hpp"
+#include "pip_tcp_reass.hpp"
+#include "pip_ring_buf.hpp"
+#include <sys/uio.h>
 
 class pip_tcp_packet;
 class pip_tcp;
@@ -21,13 +26,67 @@ typedef void (*pip_tcp_connected_callback) (pip_tcp * tcp);
 /// 关闭回调 在这个时候资源已经释放完成
 typedef void (*pip_tcp_closed_callback) (pip_tcp * tcp, void *arg);
 
-/// 数据接收回调
+/// 数据接收回调 补上空缺时 之前缓存的乱序数据按数据段分多次回调
 typedef void (*pip_tcp_received_callback) (pip_tcp * tcp, const void * buffer, pip_uint32 buffer_len);
 
-/// 数据发送完成回调 writeen_len完成发送的字节
-typedef void (*pip_tcp_written_callback) (pip_tcp * tcp, pip_uint16 writeen_len);
+/// 数据发送完成回调 writeen_len 本次被确认的字节 对方窗口从0打开时为0 表示可以继续写入
+typedef void (*pip_tcp_written_callback) (pip_tcp * tcp, pip_uint32 writeen_len);
+
+/// 借出缓冲释放回调 借出的数据全部被确认或连接释放后调用 之后调用方才可以释放 bytes
+typedef void (*pip_tcp_lent_callback) (pip_tcp * tcp, const void * bytes, pip_uint32 len, void * arg);
+
+/// 调用方借出的发送数据
+struct pip_tcp_lent {
+    const void * bytes;
+    pip_uint32 len;
+    
+    /// 已确认的长度
+    pip_uint32 acked;
+    
+    /// bytes 所在的共享数据块 持有一个引用 全部确认后释放
+    pip_buf_block * block;
+    
+    pip_tcp_lent_callback callback;
+    void * arg;
+    
+    /// 之后借出的缓冲 数据段可以跨越多个借出缓冲
+    pip_tcp_lent * next;
+};
+
+/// 连接建立时预先填充的头部 发送数据段只填充可变字段
+struct pip_tcp_template {
+    /// IP头部
+    pip_ip_template ip;
+    
+    /// 网络字节序 本端端口 对方端口
+    pip_uint16 sport;
+    pip_uint16 dport;
+    
+    /// TCP校验和中伪头部地址 协议和端口的部分和 未取反
+    pip_uint32 sum;
+};
+
+/// 连接统计
+struct pip_tcp_stats {
+    /// 单独发送的ACK
+    pip_uint64 acks_sent;
+    
+    /// 因延迟确认或捎带确认少发的ACK
+    pip_uint64 acks_saved;
+    
+    /// 重复ACK触发的快速重传 包括快速恢复中部分确认触发的重传
+    pip_uint64 fast_retransmits;
+    
+    /// 超时重传 包括超时后部分确认触发的重传
+    pip_uint64 timeout_retransmits;
+    
+    /// 对方窗口为0时发送的窗口探测
+    pip_uint64 window_probes;
+};
 
 class pip_tcp {
+    friend class pip_tcp_packet;
+    
     pip_tcp();
     ~pip_tcp();
     
@@ -35,11 +94,37 @@ class pip_tcp {
 public:
     
     static void input(const void * bytes, pip_ip_header * ip_header);
-    static void timer_tick();
+    
+    /// 批量输入开始 之后立即确认和乱序数据的重复确认先挂起 到 end_batch 时合并发送
+    /// 只合并确认 每个数据包仍然单独经过状态机处理
+    static void begin_batch();
+    
+    /// 批量输入结束 发送挂起的ACK 已随数据确认的不再发送
+    /// 空缺还没补上时 重复确认按挂起的个数发送 最多 PIP_TCP_DUP_ACK_THRESH 个 保证对方能触发快速重传
+    static void end_batch();
     
     /// 获取当前连接数
     static pip_uint32 current_connections();
     
+    /// 获取所有连接缓存的乱序数据字节
+    static pip_uint32 current_reass_bytes();
+    
+    /// 获取所有连接的接收缓冲总和
+    static pip_uint64 current_rcv_buf_bytes();
+    
+    /// 获取所有连接的统计合计
+    static pip_tcp_stats global_stats();
+    
+    /// 从对象池分配 对象按缓存行对齐
+    static void * operator new(size_t size);
+    static void operator delete(void * ptr);
+    
+    /// 连接对象池 可以按预计连接数预分配
+    static pip_pool * get_pool();
+    
+    /// 借出缓冲对象池 writev_lent 和引用数据块发送时使用
+    static pip_pool * get_lent_pool();
+    
     /// 建立连接
     /// @param bytes 发起端的建立连接时的数据 tcphdr
     void connected(const void * bytes);
@@ -52,11 +137,25 @@ public:
     
     
     /// 发送数据 返回发送的长度
+    /// 未确认数据不超过对方窗口和 snd_buf 时可以连续写入 不需要等待上一次写入被确认
     pip_uint32 write(const void *bytes, pip_uint32 len);
     
-    /// 接受数据之后调用更新窗口
+    /// 发送多段数据 和 write 相同 各段直接复制到发送缓冲 返回发送的长度
+    pip_uint32 writev(const struct iovec * iov, int iovcnt);
+    
+    /// 零拷贝发送 数据包直接引用调用方的缓冲 返回发送的长度
+    /// 每段缓冲被接受的部分全部确认后 以该段起始地址和接受的长度调用一次 callback
+    /// 未被接受的部分需要之后重新写入
+    pip_uint32 writev_lent(const struct iovec * iov, int iovcnt, pip_tcp_lent_callback callback, void * arg);
+    
+    /// 发送 pip_buf 链表 返回发送的长度
+    /// 带共享数据块的 buf 不复制 数据包引用同一数据块 确认后释放引用 调用方可以继续持有 buf
+    /// 其他 buf 复制到发送缓冲
+    pip_uint32 write_buf(pip_buf * buf);
+    
+    /// 接受数据之后调用更新窗口 同时根据读取速度自动扩大接收缓冲
     /// @param len 接受的数据大小
-    void received(pip_uint16 len);
+    void received(pip_uint32 len);
     
     /// 输出当前状态
     void debug_status();
@@ -67,49 +166,71 @@ public:
     /// 写之前调用该方法判断当前是否能写
     bool can_write();
     
-public:
-    pip_tcp_connected_callback connected_callback;
-    pip_tcp_closed_callback closed_callback;
-    pip_tcp_received_callback received_callback;
-    pip_tcp_written_callback written_callback;
+    /// 当前还可以写入的字节数 受发送缓冲 对方窗口和拥塞窗口限制
+    pip_uint32 send_window();
     
-public:
-    pip_ip_header * ip_header;
+private:
     
-    pip_uint16 src_port;
-    pip_uint16 dest_port;
+    /// 发送数据包
+    void send_packet(pip_tcp_packet *packet);
     
-    pip_tcp_status status;
+    /// 重新发送数据包
+    void resend_packet(pip_tcp_packet *packet);
     
-    pip_uint32 seq;
-    pip_uint32 ack;
+    /// 引用发送缓冲中的数据 环绕时返回两段 buf 的链表
+    /// @param offset 相对发送缓冲头部的偏移
+    /// @param len _
+    pip_buf * ring_payload(pip_uint32 offset, pip_uint32 len);
     
-    /// mss
-    pip_uint16 mss;
+    /// 数据包引用的数据
+    /// @param lent 借出的缓冲 为空时引用发送缓冲
+    /// @param offset 相对借出缓冲或发送缓冲头部的偏移 可以超过 lent 的长度 延续到之后借出的缓冲
+    /// @param len _
+    pip_buf * payload_buf(pip_tcp_lent * lent, pip_uint32 offset, pip_uint32 len);
     
-    /// 对方的mss
-    pip_uint16 opp_mss;
+    /// 把超过 lent 长度的偏移换算到之后借出的缓冲
+    static void seek_lent(pip_tcp_lent ** lent, pip_uint32 * offset);
     
-    /// 接收窗口大小
-    pip_uint16 wind;
+    /// 复制到发送缓冲 不分段 返回复制的长度
+    pip_uint32 copy_ring(const struct iovec * iov, int iovcnt);
     
-    /// 对方的窗口大小
-    pip_uint16 opp_wind;
+    /// 发送缓冲容量的上限 内存紧张时缩小
+    pip_uint32 snd_ring_size();
     
-    /// 外部使用-用于区分
-    void * arg;
+    /// 发送缓冲不足 size 时按需要翻倍 按增加的容量记账
+    /// 已发出的数据包改为引用新缓冲
+    bool grow_ring(pip_uint32 size);
     
-private:
+    /// 数据全部确认后释放较大的发送缓冲 记账跟随在途数据
+    void shrink_ring();
     
-    /// 发送数据包
-    void send_packet(pip_tcp_packet *packet);
+    /// 复制到发送缓冲并发送
+    /// @param push 最后一段是否带 PUSH
+    pip_uint32 write_ring(const struct iovec * iov, int iovcnt, bool push);
     
-    /// 重新发送数据包
-    void resend_packet(pip_tcp_packet *packet);
+    /// 添加借出缓冲到队列
+    pip_tcp_lent * add_lent(const void * bytes, pip_uint32 len, pip_buf_block * block, pip_tcp_lent_callback callback, void * arg);
+    
+    /// 按 opp_mss 分段发送已经放入缓冲的数据
+    /// @param push 最后一段是否带 PUSH
+    void send_segments(pip_tcp_lent * lent, pip_uint32 offset, pip_uint32 len, bool push);
+    
+    /// 数据包前 len 字节已确认 释放对应的缓冲
+    void release_acked(pip_tcp_packet * packet, pip_uint32 len);
+    
+    /// 回调并移除已全部确认的借出缓冲
+    /// @param all 连接释放时全部回调
+    void release_lent(bool all);
     
     /// 发送确认ACK
     void send_ack();
     
+    /// 收到数据后按延迟确认规则决定立即确认还是等待
+    void delay_ack();
+    
+    /// 批量输入中挂起立即确认 不在批量输入中返回 false
+    bool defer_ack();
+    
     /// 处理建立连接
     void handle_syn(void * options, pip_uint16 optionlen);
     
@@ -117,30 +238,233 @@ private:
     void handle_fin();
     
     /// 处理ACK确认
-    void handle_ack(pip_uint32 ack);
+    /// @param ack _
+    /// @param maybe_dup 不带数据 不改变窗口 可能是重复ACK
+    /// @param was_blocked 更新窗口前发送窗口为0
+    void handle_ack(pip_uint32 ack, bool maybe_dup, bool was_blocked);
+    
+    /// 重传队首数据包 用于快速重传
+    void fast_retransmit();
     
     /// 处理数据接收
-    void handle_receive(void * data, pip_uint16 datalen);
+    void handle_receive(void * data, pip_uint32 datalen);
+    
+    /// 补上空缺的数据 先交给上层 再把重组队列中连续的数据段逐个交给上层 最后确认一次
+    /// @param data _
+    /// @param datalen _
+    /// @param reass_seq 补上空缺的数据之后的序号
+    void handle_reass_fill(void * data, pip_uint32 datalen, pip_uint32 reass_seq);
+    
+    /// 调整窗口并回调上层
+    void deliver_data(void * data, pip_uint32 datalen);
     
     /// 处理PUSH标识
-    void handle_push(void * data, pip_uint16 datalen);
+    void handle_push(void * data, pip_uint32 datalen);
+    
+    /// 按队首数据包重新设置重传定时器 队列为空则取消
+    void restart_retransmit_timer();
+    
+    /// 开始等待关闭计时
+    void start_fin_timer();
+    
+    /// 对方窗口为0且没有未确认的数据时启动坚持定时器 否则取消
+    void update_persist_timer();
+    
+    /// 发送窗口探测 序号比已发送的小1 对方丢弃后回复当前窗口
+    void send_window_probe();
+    
+    /// 根据上层读取速度调整接收缓冲
+    void autotune_rcv_buf(pip_uint32 len);
+    
+    /// 四元组确定后填充头部模板
+    void init_header_template();
+    
+    /// 头部中的窗口 SYN 中的窗口不扩大
+    pip_uint16 header_wind(pip_uint8 flags);
+    
+    /// 发出的包携带了确认号和窗口 记录通告的值 合并等待确认的数据段
+    /// @param hdr _
+    /// @param is_pure_ack 是否是单独的ACK
+    void sent_ack(struct tcphdr * hdr, bool is_pure_ack);
+    
+    /// 已发送未确认的字节
+    pip_uint32 flight_size();
+    
+    /// 检测到丢包 慢启动阈值减为在途数据的一半 不小于两个数据段
+    void reduce_ssthresh();
+    
+    /// 新数据被确认 慢启动或拥塞避免增大拥塞窗口
+    /// @param acked 确认的字节
+    void grow_cwnd(pip_uint32 acked);
+    
+    /// 根据RTT样本更新 SRTT RTTVAR RTO
+    /// @param rtt 毫秒
+    void update_rtt(pip_uint32 rtt);
+    
+    static void retransmit_timer_callback(pip_timer * timer, void * arg);
+    static void fin_timer_callback(pip_timer * timer, void * arg);
+    static void ack_timer_callback(pip_timer * timer, void * arg);
+    static void persist_timer_callback(pip_timer * timer, void * arg);
+    
+public:
+    // MARK: 热数据 第一 二个缓存行 每个数据段收发都读写的序号 窗口和发送队列
+    
+    pip_tcp_status status;
+    
+    /// 窗口扩大因子
+    pip_uint8 wscale;
+    
+    /// 对方的窗口扩大因子
+    pip_uint8 opp_wscale;
+    
+    /// 是否延迟确认 每两个数据段或超时确认一次 PUSH 乱序数据立即确认
+    bool delayed_ack;
+    
+    pip_uint16 src_port;
+    pip_uint16 dest_port;
+    
+    /// mss
+    pip_uint16 mss;
+    
+    /// 对方的mss
+    pip_uint16 opp_mss;
+    
+    pip_uint32 seq;
+    pip_uint32 ack;
+    
+    /// 接收窗口大小
+    pip_uint32 wind;
+    
+    /// 对方的窗口大小 已按扩大因子换算
+    pip_uint32 opp_wind;
+    
+    /// 发送缓冲上限 已发送未确认的数据不超过该值
+    pip_uint32 snd_buf;
     
 private:
+    /// 最后一次ack
+    pip_uint32 _last_ack;
+    
+    /// 最后一次通告的窗口
+    pip_uint32 _adv_wind;
+    
+    /// 接收缓冲大小 窗口上限
+    pip_uint32 _rcv_buf;
+    
+    /// 等待确认的数据段数量
+    pip_uint32 _ack_pending;
+    
+    /// 借出缓冲中已发送未确认的数据长度
+    pip_uint32 _lent_len;
+    
+    /// 当前重传超时 毫秒 超时后指数退避
+    pip_uint32 _rto;
+    
+    /// 连续收到的重复ACK数量
+    pip_uint32 _dup_acks;
+    
+    /// 进入快速恢复或超时重传时已发送的最大序号 确认到这里才退出恢复
+    pip_uint32 _recover;
+    
+    /// 拥塞窗口 字节 RFC 5681 慢启动和拥塞避免
+    pip_uint32 _cwnd;
+    
+    /// 慢启动阈值 字节
+    pip_uint32 _ssthresh;
+    
+    /// 是否处于快速恢复
+    bool _in_recovery;
+    
+    /// 超时重传后还没确认到 _recover 每个部分确认立即重传下一个缺口
+    bool _rto_recovery;
+    
+    /// 下一次收到数据立即确认
+    bool _ack_now;
+    
+    /// 批量输入中挂起了立即确认
+    bool _ack_deferred;
+    
+    /// 批量输入中挂起的乱序重复确认数量 不超过 PIP_TCP_DUP_ACK_THRESH
+    pip_uint8 _dup_acks_deferred;
+    
+    /// 发送缓冲 保存已发送未确认的数据 按字节确认释放
+    pip_ring_buf _snd_ring;
     
     /// 需要等待确认的包队列
-    pip_queue<pip_tcp_packet *> * _packet_queue;
+    pip_queue<pip_tcp_packet *> _packet_queue;
+    
+    // MARK: 第三 四个缓存行 每个数据段都会更新的定时器 RTT 和统计
+    
+    /// 重传定时器
+    pip_timer _retransmit_timer;
+    
+    /// 延迟确认定时器
+    pip_timer _ack_timer;
+    
+    /// 平滑RTT 毫秒 0表示还没有样本
+    pip_uint32 _srtt;
     
-    /// 当前连接标识
+    /// RTT偏差 毫秒
+    pip_uint32 _rttvar;
+    
+public:
+    /// 连接统计
+    pip_tcp_stats stats;
+    
+    // MARK: 第五 六个缓存行 按路径访问 收发数据时的回调 校验和卸载时的地址 发包时的头部模板 乱序和借出缓冲
+    
+    pip_tcp_received_callback received_callback;
+    pip_tcp_written_callback written_callback;
+    
+    /// 对方地址 主机字节序 需要显示时使用 pip_ip_to_str
+    pip_uint32 src_ip;
+    
+    /// 本端地址 主机字节序
+    pip_uint32 dest_ip;
+    
+private:
+    /// 头部模板
+    pip_tcp_template _header_template;
+    
+    /// 乱序数据重组队列
+    pip_tcp_reass _reass;
+    
+    /// 借出缓冲队列 按发送顺序
+    pip_queue<pip_tcp_lent *> _lent_queue;
+    
+    /// 当前统计周期内上层读取的字节
+    pip_uint32 _rcv_consumed;
+    
+    /// 当前统计周期开始时间
+    pip_uint64 _rcv_measure_time;
+    
+public:
+    // MARK: 冷数据 只在建立 关闭和对方窗口为0时访问
+    
+    pip_tcp_connected_callback connected_callback;
+    pip_tcp_closed_callback closed_callback;
+    
+    /// 外部使用-用于区分
+    void * arg;
+    
+private:
+    /// 连接四元组
+    pip_flow_key _flow_key;
+    
+    /// 当前连接标识 四元组hash
     pip_uint32 _iden;
     
-    /// 最后一次ack
-    pip_uint32 _last_ack;
+    /// 连接对象是否已在内存预算中记账
+    bool _mem_charged;
     
-    /// 当前是否等待确认PUSH包
-    bool _is_wait_push_ack;
-
-    /// 主动关闭时间 定期检查 防止客户端不响应ACK 导致资源占用
-    pip_uint64 _fin_time;
+    /// 主动关闭定时器 防止客户端不响应ACK 导致资源占用
+    pip_timer _fin_timer;
+    
+    /// 坚持定时器 对方窗口为0时定期探测 防止窗口更新丢失后连接停住
+    pip_timer _persist_timer;
+    
+    /// 连续窗口探测次数 探测间隔按 RTO 指数退避
+    pip_uint8 _persist_backoff;
 };
 
 
@@ -152,6 +476,13 @@ public:
     ~pip_tcp_packet();
     
     pip_tcp_packet(pip_tcp *tcp, pip_uint8 flags, pip_buf * option_buf, pip_buf * payload_buf, const char * debug_iden);
+    
+    /// 从对象池分配
+    static void * operator new(size_t size);
+    static void operator delete(void * ptr);
+    
+    /// 对象池 可以预分配和查看统计
+    static pip_pool * get_pool();
   
     
     /// 获取 tcphdr
@@ -172,12 +503,40 @@ public:
     /// 发送一次调用一次
     void sended();
     
+    /// 数据包前 len 字节已被确认 替换为剩余的数据并重新填充头部
+    /// @param tcp _
+    /// @param len 已确认的长度
+    /// @param payload_buf 剩余的数据
+    /// 借出缓冲的位置由调用方通过 set_lent 更新
+    void trim(pip_tcp *tcp, pip_uint32 len, pip_buf * payload_buf);
+    
+    /// 设置数据所在的借出缓冲
+    /// @param lent _
+    /// @param offset 数据在借出缓冲中的偏移
+    void set_lent(pip_tcp_lent * lent, pip_uint32 offset);
+    
+    /// 获取数据所在的借出缓冲 数据在发送缓冲时为空
+    pip_tcp_lent * get_lent();
+    
+    /// 获取数据在借出缓冲中的偏移
+    pip_uint32 get_lent_offset();
+    
+    /// 重传前更新为当前的确认号和窗口 校验和按改变的字段增量更新
+    void refresh(pip_tcp *tcp);
+    
+private:
+    /// 填充头部并计算校验和
+    void fill_header(pip_tcp *tcp, pip_uint32 seq, pip_uint8 flags);
+    
 private:
     /// 头部信息
     pip_buf * _head_buf;
     
-    /// 数据信息
-    pip_uint8 * _buffer;
+    /// 选项信息 属于 _head_buf 链表
+    pip_buf * _option_buf;
+    
+    /// 头部数据 前面预留IP头部
+    pip_uint8 _buffer[PIP_IP_HEADROOM + sizeof(struct tcphdr)];
     
     /// 数据长度
     pip_uint32 _payload_len;
@@ -188,6 +547,10 @@ private:
     /// 发送次数
     pip_uint8 _send_count;
     
+    /// 借出缓冲
+    pip_tcp_lent * _lent;
+    pip_uint32 _lent_offset;
+    
     /// 调试使用
     const char * _debug_iden;
     
@@ -0,0 +1,226 @@
+//
+//  pip_tcp_reass.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include "pip_tcp_reass.hpp"
+#include "pip_mem.hpp"
+#include "pip_pool.hpp"
+#include <string.h>
+
+/// 所有连接缓存的乱序数据
+static pip_uint32 reass_total_bytes = 0;
+
+static inline bool seq_lt(pip_uint32 a, pip_uint32 b) {
+    return (pip_int32)(a - b) < 0;
+}
+
+static inline bool seq_leq(pip_uint32 a, pip_uint32 b) {
+    return (pip_int32)(a - b) <= 0;
+}
+
+pip_tcp_reass::pip_tcp_reass() {
+    this->_head = NULL;
+    this->_tail = NULL;
+    this->_bytes = 0;
+    this->_count = 0;
+}
+
+pip_tcp_reass::~pip_tcp_reass() {
+    this->clear();
+}
+
+bool pip_tcp_reass::insert(pip_uint32 seq, const void * data, pip_uint32 len, pip_uint8 flags, pip_uint32 max_bytes) {
+    if (len <= 0) {
+        return false;
+    }
+
+    const pip_uint8 * bytes = (const pip_uint8 *)data;
+
+    pip_tcp_reass_seg * prev = NULL;
+    pip_tcp_reass_seg * next = this->_head;
+    if (this->_tail && seq_leq(this->_tail->seq, seq)) {
+        /// 丢包后续的数据段大多按顺序到达 直接接在末尾
+        prev = this->_tail;
+        next = NULL;
+    }
+
+    while (next && seq_leq(next->seq, seq)) {
+        prev = next;
+        next = next->next;
+    }
+
+    if (prev) {
+        /// 裁掉与前一段重叠的部分
+        pip_uint32 prev_end = prev->seq + prev->len;
+        if (seq_leq(seq + len, prev_end)) {
+            return false;
+        }
+
+        if (seq_lt(seq, prev_end)) {
+            pip_uint32 d = prev_end - seq;
+            seq += d;
+            bytes += d;
+            len -= d;
+        }
+    }
+
+    /// 接收缓冲扩大后 数据段数量上限随可以缓存的 MSS 数放宽
+    pip_uint32 max_segs = PIP_MAX((pip_uint32)PIP_TCP_REASS_MAX_SEGS, max_bytes / PIP_TCP_MSS);
+    if (this->_count >= max_segs ||
+        this->_bytes + len > max_bytes ||
+        reass_total_bytes + len > PIP_TCP_REASS_MAX_TOTAL ||
+        !pip_mem::available(len)) {
+        return false;
+    }
+
+    /// 新数据段完全覆盖的后续段直接释放
+    while (next && seq_leq(next->seq + next->len, seq + len)) {
+        pip_tcp_reass_seg * covered = next;
+        next = next->next;
+        flags |= covered->flags;
+        this->free_seg(covered);
+    }
+
+    if (next && seq_lt(next->seq, seq + len)) {
+        /// 裁掉与后一段重叠的部分 FIN 只能在数据末尾
+        len = next->seq - seq;
+        flags &= ~TH_FIN;
+    }
+
+    if (len == 0) {
+        /// 裁掉前面重叠后正好从后一段开始 没有新数据
+        return false;
+    }
+
+    /// 前面已经检查过预算 释放覆盖的数据段只会减少使用
+    pip_mem::charge(pip_mem_type_tcp_reass, len);
+    pip_tcp_reass_seg * seg;
+    if (len <= PIP_TCP_REASS_SEG_DATA) {
+        seg = (pip_tcp_reass_seg *)get_pool()->alloc();
+    } else {
+        seg = (pip_tcp_reass_seg *)malloc(sizeof(pip_tcp_reass_seg) + len);
+    }
+    if (seg == NULL) {
+        pip_mem::uncharge(pip_mem_type_tcp_reass, len);
+        return false;
+    }
+    seg->seq = seq;
+    seg->len = len;
+    seg->flags = flags;
+    seg->next = next;
+    memcpy(seg->data(), bytes, len);
+
+    if (prev) {
+        prev->next = seg;
+    } else {
+        this->_head = seg;
+    }
+
+    if (next == NULL) {
+        this->_tail = seg;
+    }
+
+    this->_bytes += len;
+    this->_count += 1;
+    reass_total_bytes += len;
+    return true;
+}
+
+pip_uint32 pip_tcp_reass::contiguous_len(pip_uint32 seq, pip_uint8 * flags) {
+    pip_uint32 cur = seq;
+    pip_uint8 contiguous_flags = 0;
+    for (pip_tcp_reass_seg * seg = this->_head; seg != NULL; seg = seg->next) {
+        pip_uint32 end = seg->seq + seg->len;
+        if (seq_leq(end, cur)) {
+            continue;
+        }
+
+        if (seq_lt(cur, seg->seq)) {
+            break;
+        }
+
+        cur = end;
+        contiguous_flags |= seg->flags;
+    }
+
+    if (flags) {
+        *flags = contiguous_flags;
+    }
+    return cur - seq;
+}
+
+pip_uint32 pip_tcp_reass::front(pip_uint32 seq, const pip_uint8 ** data) {
+    while (this->_head && seq_leq(this->_head->seq + this->_head->len, seq)) {
+        /// 按序数据已经覆盖
+        this->pop();
+    }
+
+    pip_tcp_reass_seg * seg = this->_head;
+    if (seg == NULL || seq_lt(seq, seg->seq)) {
+        return 0;
+    }
+
+    pip_uint32 offset = seq - seg->seq;
+    *data = seg->data() + offset;
+    return seg->len - offset;
+}
+
+void pip_tcp_reass::pop() {
+    pip_tcp_reass_seg * seg = this->_head;
+    if (seg == NULL) {
+        return;
+    }
+
+    this->_head = seg->next;
+    if (this->_head == NULL) {
+        this->_tail = NULL;
+    }
+    this->free_seg(seg);
+}
+
+void pip_tcp_reass::clear() {
+    while (this->_head) {
+        pip_tcp_reass_seg * seg = this->_head;
+        this->_head = seg->next;
+        this->free_seg(seg);
+    }
+    this->_tail = NULL;
+}
+
+bool pip_tcp_reass::empty() {
+    return this->_head == NULL;
+}
+
+pip_uint32 pip_tcp_reass::bytes() {
+    return this->_bytes;
+}
+
+pip_uint32 pip_tcp_reass::count() {
+    return this->_count;
+}
+
+pip_uint32 pip_tcp_reass::total_bytes() {
+    return reass_total_bytes;
+}
+
+void pip_tcp_reass::free_seg(pip_tcp_reass_seg * seg) {
+    this->_bytes -= seg->len;
+    this->_count -= 1;
+    reass_total_bytes -= seg->len;
+    pip_mem::uncharge(pip_mem_type_tcp_reass, seg->len);
+
+    /// 长度在插入后不再改变 按长度判断来源
+    if (seg->len <= PIP_TCP_REASS_SEG_DATA) {
+        get_pool()->free(seg);
+    } else {
+        free(seg);
+    }
+}
+
+pip_pool * pip_tcp_reass::get_pool() {
+    /// 不释放 保证晚于所有数据段释放
+    static pip_pool * pool = new pip_pool(sizeof(pip_tcp_reass_seg) + PIP_TCP_REASS_SEG_DATA, PIP_TCP_REASS_SLAB_SEGS);
+    return pool;
+}
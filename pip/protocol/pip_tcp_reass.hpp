@@ -0,0 +1,87 @@
+//
+//  pip_tcp_reass.hpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#ifndef pip_tcp_reass_hpp
+#define pip_tcp_reass_hpp
+
+#include "pip_type.hpp"
+
+class pip_pool;
+
+/// 乱序数据段
+struct pip_tcp_reass_seg {
+    pip_uint32 seq;
+    pip_uint32 len;
+    pip_uint8 flags;
+    pip_tcp_reass_seg * next;
+
+    /// 数据紧跟在结构体后面
+    pip_uint8 * data() {
+        return (pip_uint8 *)(this + 1);
+    }
+};
+
+/// TCP 乱序重组队列 按 seq 有序保存尚未连续的数据段
+class pip_tcp_reass {
+
+public:
+    pip_tcp_reass();
+    ~pip_tcp_reass();
+
+    /// 缓存乱序数据段 与已有数据重叠的部分会被裁掉
+    /// 超出单连接或全局上限时丢弃 返回是否缓存
+    /// @param seq 数据段起始序号
+    /// @param data _
+    /// @param len _
+    /// @param flags tcp 标识 保留 FIN
+    /// @param max_bytes 单连接最多缓存的字节 一般是当前接收缓冲
+    bool insert(pip_uint32 seq, const void * data, pip_uint32 len, pip_uint8 flags, pip_uint32 max_bytes);
+
+    /// 从 seq 开始可以连续取出的数据长度
+    /// @param seq _
+    /// @param flags 输出 可以为 NULL 连续数据段的标识合集
+    pip_uint32 contiguous_len(pip_uint32 seq, pip_uint8 * flags = NULL);
+
+    /// 队首数据段中从 seq 开始的数据 不复制 在 pop 之前有效
+    /// 完全在 seq 之前的数据段直接释放
+    /// @param seq _
+    /// @param data 输出 数据起始地址
+    /// @return 数据长度 队首不连续或队列为空时返回0
+    pip_uint32 front(pip_uint32 seq, const pip_uint8 ** data);
+
+    /// 释放队首数据段
+    void pop();
+
+    /// 释放所有数据段
+    void clear();
+
+    bool empty();
+
+    /// 当前缓存的数据字节
+    pip_uint32 bytes();
+
+    /// 当前缓存的数据段数量
+    pip_uint32 count();
+
+    /// 所有连接缓存的乱序数据字节
+    static pip_uint32 total_bytes();
+
+    /// 数据段对象池 数据不超过 PIP_TCP_REASS_SEG_DATA 的数据段从这里分配
+    static pip_pool * get_pool();
+
+private:
+    void free_seg(pip_tcp_reass_seg * seg);
+
+private:
+    pip_tcp_reass_seg * _head;
+
+    /// 最后一个数据段 按顺序到达的乱序数据直接追加
+    pip_tcp_reass_seg * _tail;
+    pip_uint32 _bytes;
+    pip_uint32 _count;
+};
+
+#endif /* pip_tcp_reass_hpp */
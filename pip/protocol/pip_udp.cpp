@@ -9,6 +9,7 @@
 #include "pip_debug.hpp"
 #include "pip_netif.hpp"
 #include "pip_checksum.hpp"
+#include <string.h>
 
 void pip_udp::input(const void *bytes, pip_ip_header * ip_header) {
     
@@ -21,39 +22,107 @@ void pip_udp::input(const void *bytes, pip_ip_header * ip_header) {
     void * data = (pip_uint8 *)bytes + sizeof(struct udphdr);
     
     pip_netif * netif = pip_netif::shared();
-    if (netif->received_udp_data_callback) {
-        netif->received_udp_data_callback(netif, data, datalen, ip_header->src_str, src_port, ip_header->dest_str, dest_port, ip_header->version);
+    if (netif->received_udp_packet_callback) {
+        pip_addr src;
+        src.version = ip_header->version;
+        src.port = hdr->uh_sport;
+        src.ip.v4 = htonl(ip_header->src);
+        
+        pip_addr dest;
+        dest.version = ip_header->version;
+        dest.port = hdr->uh_dport;
+        dest.ip.v4 = htonl(ip_header->dest);
+        
+        netif->received_udp_packet_callback(netif, data, datalen, &src, &dest);
+        
+    } else if (netif->received_udp_data_callback) {
+        /// 有回调时才格式化地址
+        pip_ip_str src_str = pip_ip_to_str(ip_header->src);
+        pip_ip_str dest_str = pip_ip_to_str(ip_header->dest);
+        netif->received_udp_data_callback(netif, data, datalen, src_str.str, src_port, dest_str.str, dest_port, ip_header->version);
     }
     
 #if PIP_DEBUG
     pip_debug_output_udp(hdr, "udp_input");
 #endif
-    
-    delete ip_header;
 }
 
 void pip_udp::output(const void *buffer, pip_uint16 buffer_len, const char * src_ip, pip_uint16 src_port, const char * dest_ip, pip_uint16 dest_port) {
- 
-    pip_buf * payload_buf = new pip_buf((void *)buffer, buffer_len, 0);
-    pip_buf * udp_head_buf = new pip_buf(sizeof(struct udphdr));
-    udp_head_buf->set_next(payload_buf);
-    
-    pip_uint16 total_len = sizeof(struct udphdr) + buffer_len;
-    in_addr_t src_addr = inet_addr(src_ip);
-    in_addr_t dest_addr = inet_addr(dest_ip);
+    
+    pip_addr src;
+    src.version = 4;
+    src.port = htons(src_port);
+    src.ip.v4 = inet_addr(src_ip);
+    
+    pip_addr dest;
+    dest.version = 4;
+    dest.port = htons(dest_port);
+    dest.ip.v4 = inet_addr(dest_ip);
+    
+    pip_udp::output(buffer, buffer_len, &src, &dest);
+}
+
+bool pip_udp::output(const void *buffer, pip_uint16 buffer_len, const pip_addr * src, const pip_addr * dest) {
+    if (src->version != 4 || dest->version != 4) {
+        return false;
+    }
+    
+    /// 头部和数据放在同一块内存 前面预留IP头部
+    pip_buf * buf = new pip_buf(PIP_UDP_HEADROOM, buffer_len);
+    memcpy(buf->payload, buffer, buffer_len);
+    
+    bool ret = pip_udp::output_buf(buf, src, dest);
+    delete buf;
+    return ret;
+}
 
+bool pip_udp::output_buf(pip_buf * buf, const pip_addr * src, const pip_addr * dest) {
+    if (src->version != 4 || dest->version != 4) {
+        return false;
+    }
+    
+    pip_uint32 src_addr = ntohl(src->ip.v4);
+    pip_uint32 dest_addr = ntohl(dest->ip.v4);
+    
+    /// 预留空间足够时UDP头部直接写在数据前面 否则单独分配放在链表头部
+    pip_buf * udp_head_buf = NULL;
+    if (buf->pre == NULL && buf->next == NULL && buf->headroom >= (int)PIP_UDP_HEADROOM) {
+        buf->add_header(sizeof(struct udphdr));
+        udp_head_buf = buf;
+    } else {
+        udp_head_buf = new pip_buf(PIP_IP_HEADROOM, sizeof(struct udphdr));
+        udp_head_buf->set_next(buf);
+    }
+    
     struct udphdr *hdr = (struct udphdr*)udp_head_buf->payload;
-    hdr->uh_dport = htons(dest_port);
-    hdr->uh_sport = htons(src_port);
-    hdr->uh_ulen = htons(total_len);
+    hdr->uh_dport = dest->port;
+    hdr->uh_sport = src->port;
+    hdr->uh_ulen = htons(udp_head_buf->total_len);
     hdr->uh_sum = 0;
     
-
-    hdr->uh_sum = pip_inet_checksum_buf(udp_head_buf, IPPROTO_UDP, ntohl(src_addr), ntohl(dest_addr));
-    hdr->uh_sum = htons(hdr->uh_sum);
-
-    pip_netif::shared()->output(udp_head_buf, IPPROTO_UDP, ntohl(src_addr), ntohl(dest_addr));
+    if (pip_netif::shared()->is_checksum_offload()) {
+        /// 只填伪头部的和 不取反 由内核补全
+        pip_uint32 sum = pip_inet_pseudo_sum(IPPROTO_UDP, src_addr, dest_addr) + udp_head_buf->total_len;
+        hdr->uh_sum = htons(pip_checksum_fold(sum));
+        
+    } else {
+        if (udp_head_buf->next == NULL) {
+            hdr->uh_sum = pip_inet_checksum(udp_head_buf->payload, IPPROTO_UDP, src_addr, dest_addr, udp_head_buf->total_len);
+        } else {
+            hdr->uh_sum = pip_inet_checksum_buf(udp_head_buf, IPPROTO_UDP, src_addr, dest_addr);
+        }
+        /// 计算结果为0时发送全1 0表示没有校验和
+        hdr->uh_sum = hdr->uh_sum == 0 ? 0xFFFF : htons(hdr->uh_sum);
+    }
     
-    delete udp_head_buf;
+    pip_netif::shared()->output(udp_head_buf, IPPROTO_UDP, src_addr, dest_addr);
+    
+    if (udp_head_buf == buf) {
+        buf->remove_header(sizeof(struct udphdr));
+    } else {
+        udp_head_buf->set_next(NULL);
+        delete udp_head_buf;
+    }
     
+    return true;
 }
@@ -10,12 +10,30 @@
 
 #include "pip_type.hpp"
 #include "pip_ip_header.hpp"
+#include "pip_buf.hpp"
+
+/// 零拷贝发送时数据前面需要预留的空间 UDP头部和IP头部
+#define PIP_UDP_HEADROOM    (PIP_IP_HEADROOM + sizeof(struct udphdr))
 
 class pip_udp {
     
 public:
     static void input(const void *bytes, pip_ip_header * ip_data);
     static void output(const void *buffer, pip_uint16 buffer_len, const char * src_ip, pip_uint16 src_port, const char * dest_ip, pip_uint16 dest_port);
+    
+    /// 发送UDP数据 二进制地址 数据复制一次到连续内存 暂不支持IPv6 返回是否发送
+    /// @param buffer _
+    /// @param buffer_len _
+    /// @param src 来源地址
+    /// @param dest 目的地址
+    static bool output(const void *buffer, pip_uint16 buffer_len, const pip_addr * src, const pip_addr * dest);
+    
+    /// 零拷贝发送 buf 为单个 buf 并且预留了 PIP_UDP_HEADROOM 时头部直接写在数据前面
+    /// 否则头部单独分配 调用返回后 buf 恢复原样
+    /// @param buf 数据
+    /// @param src 来源地址
+    /// @param dest 目的地址
+    static bool output_buf(pip_buf * buf, const pip_addr * src, const pip_addr * dest);
 };
 
 
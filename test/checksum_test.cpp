@@ -0,0 +1,107 @@
+//
+//  checksum_test.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "pip_checksum.hpp"
+
+/// 所有 checksum 实现与逐字节的 RFC 1071 计算对比 覆盖 0-63 字节的起始对齐
+/// 长度 0 到 CHECKSUM_TEST_FULL_LEN 逐个检查 之后到 65535 按步长抽样
+/// 有不一致时输出第一处并返回非0
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp test/checksum_test.cpp -o checksum_test
+
+#define CHECKSUM_TEST_ALIGNS        64
+#define CHECKSUM_TEST_FULL_LEN      4096
+#define CHECKSUM_TEST_MAX_LEN       65535
+#define CHECKSUM_TEST_STRIDE        61
+
+/// 与实现无关的计算 大端16位累加 最后折叠
+static pip_uint16 checksum_expected(const pip_uint8 * ptr, int len, pip_uint32 sum) {
+    pip_uint64 total = sum;
+    for (int i = 0; i + 1 < len; i += 2) {
+        total += (pip_uint32)ptr[i] << 8 | ptr[i + 1];
+    }
+    if (len & 1) {
+        total += (pip_uint32)ptr[len - 1] << 8;
+    }
+    while (total >> 16) {
+        total = (total & 0xffff) + (total >> 16);
+    }
+    return (pip_uint16)total;
+}
+
+/// 检查一个实现 返回检查的数量 不一致时返回 -1
+static long check_kernel(pip_checksum_kernel kernel, const std::vector<pip_uint8> & data, const char * pattern) {
+    /// 初始值包括0 需要进位的值和未折叠的值
+    const pip_uint32 inits[] = {0, 0xffff, 0x1fffe};
+    long checked = 0;
+    
+    for (int align = 0; align < CHECKSUM_TEST_ALIGNS; align++) {
+        const pip_uint8 * ptr = data.data() + align;
+        
+        for (int len = 0; len <= CHECKSUM_TEST_MAX_LEN; len += len < CHECKSUM_TEST_FULL_LEN ? 1 : CHECKSUM_TEST_STRIDE) {
+            /// 抽样的长度只用初始值0
+            size_t init_count = len <= CHECKSUM_TEST_FULL_LEN ? sizeof(inits) / sizeof(inits[0]) : 1;
+            for (size_t i = 0; i < init_count; i++) {
+                pip_uint16 expected = checksum_expected(ptr, len, inits[i]);
+                pip_uint16 actual = pip_checksum_fold(pip_standard_checksum(ptr, len, inits[i]));
+                
+                /// 长度为0时原样返回初始值 折叠后比较
+                if (actual != expected) {
+                    printf("FAIL %s %s align %d len %d init 0x%x expected 0x%04x actual 0x%04x\n", pip_checksum_kernel_name(kernel), pattern, align, len, inits[i], expected, actual);
+                    return -1;
+                }
+                checked++;
+            }
+        }
+        
+        /// 最大长度单独检查 步长不一定落在 65535 上
+        pip_uint16 expected = checksum_expected(ptr, CHECKSUM_TEST_MAX_LEN, 0);
+        pip_uint16 actual = pip_checksum_fold(pip_standard_checksum(ptr, CHECKSUM_TEST_MAX_LEN, 0));
+        if (actual != expected) {
+            printf("FAIL %s %s align %d len %d expected 0x%04x actual 0x%04x\n", pip_checksum_kernel_name(kernel), pattern, align, CHECKSUM_TEST_MAX_LEN, expected, actual);
+            return -1;
+        }
+        checked++;
+    }
+    return checked;
+}
+
+int main() {
+    std::vector<pip_uint8> random_data(CHECKSUM_TEST_MAX_LEN + CHECKSUM_TEST_ALIGNS);
+    pip_uint32 state = 12345;
+    for (size_t i = 0; i < random_data.size(); i++) {
+        state = state * 1103515245 + 12345;
+        random_data[i] = (pip_uint8)(state >> 16);
+    }
+    
+    /// 全部 0xff 每次累加都进位
+    std::vector<pip_uint8> ones_data(random_data.size(), 0xff);
+    
+    pip_checksum_kernel original = pip_checksum_get_kernel();
+    int failed = 0;
+    
+    for (int i = 0; i < pip_checksum_kernel_count; i++) {
+        pip_checksum_kernel kernel = (pip_checksum_kernel)i;
+        if (!pip_checksum_set_kernel(kernel)) {
+            printf("SKIP %s not supported\n", pip_checksum_kernel_name(kernel));
+            continue;
+        }
+        
+        long random_checked = check_kernel(kernel, random_data, "random");
+        long ones_checked = check_kernel(kernel, ones_data, "ones");
+        if (random_checked < 0 || ones_checked < 0) {
+            failed++;
+            continue;
+        }
+        printf("OK   %s %ld cases\n", pip_checksum_kernel_name(kernel), random_checked + ones_checked);
+    }
+    
+    pip_checksum_set_kernel(original);
+    return failed == 0 ? 0 : 1;
+}
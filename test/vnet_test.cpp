@@ -0,0 +1,202 @@
+//
+//  vnet_test.cpp
+//
+//  Created by agent on 2026/10/18.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "pip.hpp"
+#include "pip_checksum.hpp"
+#include "pip_vnet_hdr.hpp"
+
+/// 校验和卸载模式 用合成的 virtio_net_hdr 包收发
+/// 检查输出的 flags csum_start csum_offset 按内核的方式补全部分校验和后得到正确的校验和
+/// 以及输入时 DATA_VALID 跳过校验 没有标识的包仍然校验
+/// g++ -std=c++11 -O2 -Ipip -Ipip/protocol pip/*.cpp pip/protocol/*.cpp test/vnet_test.cpp -o vnet_test
+
+#define VNET_TEST_PEER_IP   0x0a000001
+#define VNET_TEST_STACK_IP  0x0a000002
+#define VNET_TEST_PEER_PORT 5000
+#define VNET_TEST_PORT      80
+
+static int failures = 0;
+
+#define VNET_TEST_CHECK(X) do { \
+    if (!(X)) { \
+        printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #X); \
+        failures++; \
+    } \
+} while (0)
+
+/// 输出的包 已经去掉 virtio_net_hdr 并补全校验和
+struct vnet_test_packet {
+    pip_vnet_hdr vnet_hdr;
+    std::vector<pip_uint8> data;
+};
+
+static std::vector<vnet_test_packet> outputs;
+static pip_tcp * stack_tcp = NULL;
+static std::string received;
+
+/// 模拟内核 从 csum_start 开始计算校验和 写到 csum_start + csum_offset
+static void output_callback(pip_netif *, pip_buf * buf) {
+    std::vector<pip_uint8> bytes;
+    for (pip_buf * q = buf; q != NULL; q = q->next) {
+        bytes.insert(bytes.end(), (pip_uint8 *)q->payload, (pip_uint8 *)q->payload + q->payload_len);
+    }
+    
+    vnet_test_packet packet;
+    memcpy(&packet.vnet_hdr, bytes.data(), sizeof(pip_vnet_hdr));
+    packet.data.assign(bytes.begin() + sizeof(pip_vnet_hdr), bytes.end());
+    
+    if (packet.vnet_hdr.flags & PIP_VNET_HDR_F_NEEDS_CSUM) {
+        pip_uint8 * start = packet.data.data() + packet.vnet_hdr.csum_start;
+        pip_uint16 sum = htons(pip_checksum_finish(pip_standard_checksum(start, (int)packet.data.size() - packet.vnet_hdr.csum_start, 0)));
+        memcpy(start + packet.vnet_hdr.csum_offset, &sum, sizeof(sum));
+    }
+    outputs.push_back(packet);
+}
+
+static void received_callback(pip_tcp * tcp, const void * buffer, pip_uint32 buffer_len) {
+    received.append((const char *)buffer, buffer_len);
+    tcp->received(buffer_len);
+}
+
+static void new_tcp_connect_callback(pip_netif *, pip_tcp * tcp, const void * take_data, pip_uint16) {
+    stack_tcp = tcp;
+    tcp->received_callback = received_callback;
+    tcp->connected(take_data);
+}
+
+/// 构造 TCP 包 校验和正确
+static std::vector<pip_uint8> make_tcp(pip_uint32 seq, pip_uint32 ack, pip_uint8 flags, const char * data) {
+    pip_uint16 len = data ? (pip_uint16)strlen(data) : 0;
+    std::vector<pip_uint8> packet(sizeof(struct ip) + sizeof(struct tcphdr) + len);
+    
+    struct ip * ip = (struct ip *)packet.data();
+    ip->ip_v = 4;
+    ip->ip_hl = 5;
+    ip->ip_len = htons(packet.size());
+    ip->ip_ttl = 64;
+    ip->ip_p = IPPROTO_TCP;
+    ip->ip_src.s_addr = htonl(VNET_TEST_PEER_IP);
+    ip->ip_dst.s_addr = htonl(VNET_TEST_STACK_IP);
+    ip->ip_sum = htons(pip_ip_checksum(ip, sizeof(struct ip)));
+    
+    struct tcphdr * hdr = (struct tcphdr *)(packet.data() + sizeof(struct ip));
+    hdr->th_sport = htons(VNET_TEST_PEER_PORT);
+    hdr->th_dport = htons(VNET_TEST_PORT);
+    hdr->th_seq = htonl(seq);
+    hdr->th_ack = htonl(ack);
+    hdr->th_off = sizeof(struct tcphdr) / 4;
+    hdr->th_flags = flags;
+    hdr->th_win = htons(0xffff);
+    if (len > 0) {
+        memcpy(hdr + 1, data, len);
+    }
+    hdr->th_sum = htons(pip_inet_checksum(hdr, IPPROTO_TCP, VNET_TEST_PEER_IP, VNET_TEST_STACK_IP, sizeof(struct tcphdr) + len));
+    return packet;
+}
+
+/// 加上 virtio_net_hdr 后输入
+static void input(const std::vector<pip_uint8> & packet, pip_uint8 flags) {
+    pip_vnet_hdr vnet_hdr;
+    memset(&vnet_hdr, 0, sizeof(vnet_hdr));
+    vnet_hdr.flags = flags;
+    
+    std::vector<pip_uint8> bytes(sizeof(vnet_hdr));
+    memcpy(bytes.data(), &vnet_hdr, sizeof(vnet_hdr));
+    bytes.insert(bytes.end(), packet.begin(), packet.end());
+    pip_netif::shared()->input(bytes.data());
+}
+
+/// 检查输出包的 virtio_net_hdr 和补全后的校验和
+static void check_output(const vnet_test_packet & packet, pip_uint8 proto) {
+    const struct ip * ip = (const struct ip *)packet.data.data();
+    pip_uint16 l4_len = packet.data.size() - sizeof(struct ip);
+    pip_uint16 csum_offset = proto == IPPROTO_TCP ? offsetof(struct tcphdr, th_sum) : offsetof(struct udphdr, uh_sum);
+    
+    VNET_TEST_CHECK(packet.vnet_hdr.flags == PIP_VNET_HDR_F_NEEDS_CSUM);
+    VNET_TEST_CHECK(packet.vnet_hdr.gso_type == PIP_VNET_HDR_GSO_NONE);
+    VNET_TEST_CHECK(packet.vnet_hdr.csum_start == sizeof(struct ip));
+    VNET_TEST_CHECK(packet.vnet_hdr.csum_offset == csum_offset);
+    VNET_TEST_CHECK(ip->ip_p == proto);
+    VNET_TEST_CHECK(pip_ip_checksum(ip, sizeof(struct ip)) == 0);
+    VNET_TEST_CHECK(pip_inet_checksum(packet.data.data() + sizeof(struct ip), proto, ntohl(ip->ip_src.s_addr), ntohl(ip->ip_dst.s_addr), l4_len) == 0);
+}
+
+int main() {
+    pip_netif * netif = pip_netif::shared();
+    netif->output_ip_data_callback = output_callback;
+    netif->new_tcp_connect_callback = new_tcp_connect_callback;
+    netif->set_checksum_offload(true);
+    netif->set_verify_checksum(true);
+    
+    /// 握手 回复的 SYN ACK 只有部分校验和
+    input(make_tcp(100, 0, TH_SYN, NULL), 0);
+    VNET_TEST_CHECK(outputs.size() == 1 && stack_tcp != NULL);
+    if (outputs.empty() || stack_tcp == NULL) {
+        return 1;
+    }
+    check_output(outputs[0], IPPROTO_TCP);
+    const struct tcphdr * syn_ack = (const struct tcphdr *)(outputs[0].data.data() + sizeof(struct ip));
+    VNET_TEST_CHECK(syn_ack->th_flags == (TH_SYN | TH_ACK));
+    pip_uint32 stack_seq = ntohl(syn_ack->th_seq) + 1;
+    input(make_tcp(101, stack_seq, TH_ACK, NULL), 0);
+    
+    /// 内核已验证的包不再校验 校验和错误也接收
+    std::vector<pip_uint8> packet = make_tcp(101, stack_seq, TH_ACK | TH_PUSH, "hello");
+    ((struct tcphdr *)(packet.data() + sizeof(struct ip)))->th_sum ^= 0x1234;
+    input(packet, PIP_VNET_HDR_F_DATA_VALID);
+    VNET_TEST_CHECK(received == "hello");
+    
+    /// 没有标识时仍然校验 校验和错误的包被丢弃
+    pip_uint64 bad = netif->get_stats().tcp_bad_checksum;
+    packet = make_tcp(106, stack_seq, TH_ACK | TH_PUSH, "world");
+    ((struct tcphdr *)(packet.data() + sizeof(struct ip)))->th_sum ^= 0x1234;
+    input(packet, 0);
+    VNET_TEST_CHECK(received == "hello");
+    VNET_TEST_CHECK(netif->get_stats().tcp_bad_checksum == bad + 1);
+    
+    /// 发送的数据段
+    outputs.clear();
+    std::string data(5000, 0);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 'a' + i % 19;
+    }
+    stack_tcp->write(data.data(), (pip_uint32)data.size());
+    VNET_TEST_CHECK(outputs.size() > 1);
+    std::string sent;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        check_output(outputs[i], IPPROTO_TCP);
+        const struct tcphdr * hdr = (const struct tcphdr *)(outputs[i].data.data() + sizeof(struct ip));
+        sent.append((const char *)outputs[i].data.data() + sizeof(struct ip) + hdr->th_off * 4, outputs[i].data.size() - sizeof(struct ip) - hdr->th_off * 4);
+    }
+    VNET_TEST_CHECK(sent == data);
+    
+    /// UDP
+    outputs.clear();
+    pip_addr src;
+    memset(&src, 0, sizeof(src));
+    src.version = 4;
+    src.port = htons(53);
+    src.ip.v4 = htonl(VNET_TEST_STACK_IP);
+    pip_addr dest = src;
+    dest.port = htons(9999);
+    dest.ip.v4 = htonl(VNET_TEST_PEER_IP);
+    VNET_TEST_CHECK(pip_udp::output("dnsreply", 8, &src, &dest));
+    VNET_TEST_CHECK(outputs.size() == 1);
+    if (outputs.size() == 1) {
+        check_output(outputs[0], IPPROTO_UDP);
+    }
+    
+    stack_tcp->reset();
+    if (failures == 0) {
+        printf("OK   vnet\n");
+    }
+    return failures == 0 ? 0 : 1;
+}